@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+
+// Heap allocations made by the process so far. The benchmarks replace the
+// global operator new to count them, so result materialization can be
+// compared by allocation count as well as by time.
+std::size_t allocation_count();
@@ -1,15 +1,21 @@
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <random>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../csv/CsvIndexedFile.hpp"
+#include "../dob/DobCsvScan.hpp"
 #include "../query/Querys.hpp"
+#include "AllocationCounter.hpp"
 
 namespace {
 
@@ -17,7 +23,15 @@ struct BenchConfig {
     std::string csv_path = "DOB_Job_Application_Filings_20260215.csv";
     std::size_t query_iters = 5;
     std::size_t index_build_iters = 2;
+    std::size_t index_threads = 0;
+    std::size_t query_threads = 1;
     bool generate_csv = false;
+    bool map_csv = false;
+    bool column_cache = false;
+    bool bitmap_indexes = false;
+    bool zone_maps = false;
+    bool batch_eval = true;
+    std::vector<std::string> range_indexes;
     std::size_t rows = 20000;
     std::size_t cols = 90;
     std::uint64_t seed = 12345;
@@ -29,6 +43,7 @@ struct BenchResult {
     double total_ms = 0.0;
     double avg_ms = 0.0;
     std::size_t items = 0;
+    std::size_t allocations = 0;    // heap allocations per iteration
 };
 
 std::string quoted(const std::string& value)
@@ -247,9 +262,25 @@ std::unique_ptr<query::Query> make_mixed_query()
     return std::make_unique<query::AndQuery>(std::move(subs));
 }
 
+std::unique_ptr<query::Query> make_date_window_query()
+{
+    // One quarter of filings; dates compare as YYYYMMDD
+    return std::make_unique<query::RangeQuery>(
+        "filing_date", 20150101.0, 20150331.0);
+}
+
+// Share of rows the last query never had to read or evaluate
+std::string format_skip_rate(const CsvQueryStats& stats)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << stats.skip_rate() * 100.0 << '%';
+    return out.str();
+}
+
 template <typename Fn>
 BenchResult run_bench(const std::string& name, std::size_t iterations, Fn&& fn)
 {
+    const std::size_t allocations = allocation_count();
     auto start = std::chrono::steady_clock::now();
     for (std::size_t i = 0; i < iterations; ++i) {
         fn();
@@ -262,6 +293,9 @@ BenchResult run_bench(const std::string& name, std::size_t iterations, Fn&& fn)
     result.iterations = iterations;
     result.total_ms = elapsed.count();
     result.avg_ms = result.total_ms / static_cast<double>(iterations);
+    result.allocations = iterations
+        ? (allocation_count() - allocations) / iterations
+        : 0;
     return result;
 }
 
@@ -305,12 +339,30 @@ BenchConfig parse_args(int argc, char** argv)
             take(config.query_iters);
         } else if (arg == "--index-iters") {
             take(config.index_build_iters);
+        } else if (arg == "--index-threads") {
+            take(config.index_threads);
+        } else if (arg == "--query-threads") {
+            take(config.query_threads);
         } else if (arg == "--seed") {
             if (i + 1 < argc) {
                 config.seed = static_cast<std::uint64_t>(std::stoull(argv[++i]));
             }
         } else if (arg == "--generate") {
             config.generate_csv = true;
+        } else if (arg == "--map-csv") {
+            config.map_csv = true;
+        } else if (arg == "--column-cache") {
+            config.column_cache = true;
+        } else if (arg == "--bitmap-indexes") {
+            config.bitmap_indexes = true;
+        } else if (arg == "--zone-maps") {
+            config.zone_maps = true;
+        } else if (arg == "--row-eval") {
+            config.batch_eval = false;
+        } else if (arg == "--range-index") {
+            if (i + 1 < argc) {
+                config.range_indexes.emplace_back(argv[++i]);
+            }
         }
     }
 
@@ -377,6 +429,7 @@ int main(int argc, char** argv)
     out << "======================================================\n";
     out << "CSV file: " << config.csv_path << '\n';
     out << "CSV size: " << (static_cast<double>(csv_size) / (1024.0 * 1024.0)) << " MB\n";
+    out << "Scanner: " << dob::scanner_isa() << '\n';
     out << "Index iters: " << config.index_build_iters
         << "  Query iters: " << config.query_iters << '\n';
     out << "======================================================\n\n";
@@ -395,6 +448,22 @@ int main(int argc, char** argv)
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << index_build.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << index_build.avg_ms << '\n';
 
+    CsvIndexedFileOptions parallel_options;
+    parallel_options.index_threads = static_cast<unsigned>(config.index_threads);
+    std::cout << "Running index_build_parallel benchmark...\n";
+    BenchResult index_build_parallel = run_bench("index_build_parallel", config.index_build_iters, [&]() {
+        std::error_code ec;
+        std::filesystem::remove(idx_path, ec);
+        CsvIndexedFile csv_temp(csv_path.string(), parallel_options);
+        (void)csv_temp.row_count();
+    });
+    out << std::left << std::setw(30) << index_build_parallel.name
+        << "  iters=" << std::setw(4) << index_build_parallel.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << index_build_parallel.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << index_build_parallel.avg_ms
+        << "  threads=" << (config.index_threads == 0 ? std::string("auto") : std::to_string(config.index_threads))
+        << '\n';
+
     std::cout << "Running index_load benchmark...\n";
     BenchResult index_load = run_bench("index_load", config.index_build_iters, [&]() {
         CsvIndexedFile csv_temp(csv_path.string());
@@ -406,18 +475,166 @@ int main(int argc, char** argv)
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << index_load.avg_ms << '\n';
 
 
+    // Cold open (no .idx) to the first match of the simple query: the
+    // blocking constructor indexes the whole file first, async_index only
+    // the first chunk
+    for (bool async : {false, true}) {
+        CsvIndexedFileOptions first_options;
+        first_options.async_index = async;
+        const char* name = async ? "first_match_async" : "first_match_cold";
+        std::cout << "Running " << name << " benchmark...\n";
+
+        double total_ms = 0.0;
+        for (std::size_t i = 0; i < config.index_build_iters; ++i) {
+            std::error_code ec;
+            std::filesystem::remove(idx_path, ec);
+
+            auto start = std::chrono::steady_clock::now();
+            CsvIndexedFile csv_temp(csv_path.string(), first_options);
+            auto q = make_simple_match_query();
+            (void)csv_temp.for_each(*q, [](const dob::DobJobApplication&) { return true; }, 1);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            total_ms += elapsed.count();
+
+            // Leave a complete .idx for the benchmarks that follow
+            csv_temp.wait_for_index();
+        }
+
+        BenchResult first_match;
+        first_match.name = name;
+        first_match.iterations = config.index_build_iters;
+        first_match.total_ms = total_ms;
+        first_match.avg_ms = config.index_build_iters ? total_ms / static_cast<double>(config.index_build_iters) : 0.0;
+        out << std::left << std::setw(30) << first_match.name
+            << "  iters=" << std::setw(4) << first_match.iterations
+            << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << first_match.total_ms
+            << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << first_match.avg_ms << '\n';
+    }
+
+    // Reopen after the last ~5% of the rows were appended: the index built
+    // for the prefix is extended by scanning only the appended bytes
+    std::cout << "Running index_extend benchmark...\n";
+    {
+        std::string data;
+        {
+            std::ifstream in(csv_path, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        const std::size_t cut = data.rfind('\n', data.size() - data.size() / 20);
+        const std::size_t prefix = cut == std::string::npos ? 0 : cut + 1;
+
+        const auto append_csv = std::filesystem::temp_directory_path() / "benchmarks_append.csv";
+        const auto append_idx = std::filesystem::path(append_csv.string() + ".idx");
+        const auto prefix_idx = std::filesystem::path(append_csv.string() + ".idx.prefix");
+        std::error_code ec;
+        std::filesystem::remove(append_idx, ec);
+        {
+            std::ofstream prefix_out(append_csv, std::ios::binary | std::ios::trunc);
+            prefix_out.write(data.data(), static_cast<std::streamsize>(prefix));
+        }
+        {
+            CsvIndexedFile csv_temp(append_csv.string());
+            (void)csv_temp.row_count();
+        }
+        std::filesystem::copy_file(append_idx, prefix_idx, std::filesystem::copy_options::overwrite_existing);
+
+        double total_ms = 0.0;
+        for (std::size_t i = 0; i < config.index_build_iters; ++i) {
+            std::filesystem::resize_file(append_csv, prefix);
+            std::filesystem::copy_file(prefix_idx, append_idx, std::filesystem::copy_options::overwrite_existing);
+            {
+                std::ofstream append_out(append_csv, std::ios::binary | std::ios::app);
+                append_out.write(data.data() + prefix, static_cast<std::streamsize>(data.size() - prefix));
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            CsvIndexedFile csv_temp(append_csv.string());
+            (void)csv_temp.row_count();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            total_ms += elapsed.count();
+        }
+
+        BenchResult index_extend;
+        index_extend.name = "index_extend";
+        index_extend.iterations = config.index_build_iters;
+        index_extend.total_ms = total_ms;
+        index_extend.avg_ms = config.index_build_iters ? total_ms / static_cast<double>(config.index_build_iters) : 0.0;
+        out << std::left << std::setw(30) << index_extend.name
+            << "  iters=" << std::setw(4) << index_extend.iterations
+            << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << index_extend.total_ms
+            << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << index_extend.avg_ms
+            << "  appended_mb=" << std::setprecision(2)
+            << static_cast<double>(data.size() - prefix) / (1024.0 * 1024.0) << '\n';
+
+        std::filesystem::remove(append_csv, ec);
+        std::filesystem::remove(append_idx, ec);
+        std::filesystem::remove(prefix_idx, ec);
+    }
+
     // ===== QUERY EXECUTION BENCHMARKS =====
     out << "\n--- QUERY EXECUTION BENCHMARKS ---\n";
 
     // Cache the CsvIndexedFile for all query executions
-    CsvIndexedFile csv(csv_path.string());
-    out << "Loaded CSV with " << csv.row_count() << " rows\n";
+    CsvIndexedFileOptions csv_options;
+    csv_options.map_csv = config.map_csv;
+    csv_options.query_threads = static_cast<unsigned>(config.query_threads);
+    csv_options.column_cache = config.column_cache;
+    csv_options.bitmap_indexes = config.bitmap_indexes;
+    csv_options.range_indexes = config.range_indexes;
+    csv_options.zone_maps = config.zone_maps;
+    csv_options.batch_eval = config.batch_eval;
+    CsvIndexedFile csv(csv_path.string(), csv_options);
+    out << "Loaded CSV with " << csv.row_count() << " rows"
+        << (csv.is_mapped() ? " (mapped)" : "")
+        << (csv.columns() ? " (column cache)" : "")
+        << (csv.bitmaps() ? " (bitmap indexes)" : "")
+        << (csv.ranges() ? " (range indexes)" : "")
+        << (csv.zones() ? " (zone maps)" : "") << '\n';
+    if (csv.columns())
+        out << "Predicate eval: "
+            << (config.batch_eval ? std::string("batch (") + query::batch_isa() + ")" : std::string("row by row")) << '\n';
+    out << "Query threads: "
+        << (config.query_threads == 0 ? std::string("auto") : std::to_string(config.query_threads)) << '\n';
     out << "Running " << config.query_iters << " iterations per query...\n\n";
     std::cout << "Running query benchmarks...\n";
 
     std::size_t sink = 0;
     std::size_t csv_total_rows = csv.row_count();
 
+    // Full parse_row throughput over rows already in memory, so the
+    // numbers exclude I/O and splitting of the file into rows
+    {
+        const std::size_t sample = std::min<std::size_t>(csv_total_rows, 200000);
+        std::vector<std::string> lines;
+        lines.reserve(sample);
+        for (std::size_t i = 0; i < sample; ++i)
+            lines.push_back(csv.read_row(i));
+
+        std::cout << "  parse_rows_full...\n";
+        sink = 0;
+        std::size_t field_errors = 0;
+        std::vector<dob::FieldError> errors;
+        BenchResult parse_rows_full = run_bench("parse_rows_full", config.query_iters, [&]() {
+            field_errors = 0;
+            for (const auto& line : lines) {
+                const dob::DobJobApplication app = dob::parse_row(line, errors);
+                field_errors += errors.size();
+                sink += static_cast<std::size_t>(app.job_number != 0);
+            }
+        });
+        parse_rows_full.items = sink;
+        const double rows_per_sec = parse_rows_full.avg_ms > 0.0
+            ? static_cast<double>(lines.size()) / (parse_rows_full.avg_ms / 1000.0)
+            : 0.0;
+        out << "  Result: " << lines.size() << " rows parsed per iteration ";
+        out << std::left << std::setw(30) << parse_rows_full.name
+            << "  iters=" << std::setw(4) << parse_rows_full.iterations
+            << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << parse_rows_full.total_ms
+            << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << parse_rows_full.avg_ms
+            << "  rows/sec=" << std::fixed << std::setprecision(0) << rows_per_sec
+            << "  field_errors=" << field_errors << '\n';
+    }
+
     std::cout << "  query_simple_match...\n";
     auto simple_match_query = make_simple_match_query();
     BenchResult query_simple_match = run_bench("query_simple_match", config.query_iters, [&]() {
@@ -435,7 +652,39 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_simple_match.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_simple_match.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_simple_match.avg_ms
-        << "  items=" << query_simple_match.items << '\n';
+        << "  items=" << query_simple_match.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // Same query without materializing: COUNT(*) and matching row ids
+    std::cout << "  query_simple_match_count...\n";
+    sink = 0;
+    BenchResult query_simple_match_count = run_bench("query_simple_match_count", config.query_iters, [&]() {
+        sink += csv.count(*simple_match_query);
+    });
+    query_simple_match_count.items = sink;
+    out << "  Result: " << query_simple_match_count.items << " total matches across "
+        << config.query_iters << " iterations ";
+    out << std::left << std::setw(30) << query_simple_match_count.name
+        << "  iters=" << std::setw(4) << query_simple_match_count.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_simple_match_count.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_simple_match_count.avg_ms
+        << "  items=" << query_simple_match_count.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    std::cout << "  query_simple_match_rows...\n";
+    sink = 0;
+    BenchResult query_simple_match_rows = run_bench("query_simple_match_rows", config.query_iters, [&]() {
+        sink += csv.match_rows(*simple_match_query).cardinality();
+    });
+    query_simple_match_rows.items = sink;
+    out << "  Result: " << query_simple_match_rows.items << " total matches across "
+        << config.query_iters << " iterations ";
+    out << std::left << std::setw(30) << query_simple_match_rows.name
+        << "  iters=" << std::setw(4) << query_simple_match_rows.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_simple_match_rows.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_simple_match_rows.avg_ms
+        << "  items=" << query_simple_match_rows.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_simple_range...\n";
     sink = 0;
@@ -455,7 +704,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_simple_range.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_simple_range.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_simple_range.avg_ms
-        << "  items=" << query_simple_range.items << '\n';
+        << "  items=" << query_simple_range.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_simple_string...\n";
     sink = 0;
@@ -475,7 +725,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_simple_string.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_simple_string.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_simple_string.avg_ms
-        << "  items=" << query_simple_string.items << '\n';
+        << "  items=" << query_simple_string.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_and_two_cond...\n";
     sink = 0;
@@ -495,7 +746,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_and_two.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_and_two.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_and_two.avg_ms
-        << "  items=" << query_and_two.items << '\n';
+        << "  items=" << query_and_two.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_and_three_cond...\n";
     sink = 0;
@@ -515,7 +767,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_and_three.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_and_three.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_and_three.avg_ms
-        << "  items=" << query_and_three.items << '\n';
+        << "  items=" << query_and_three.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_and_four_cond...\n";
     sink = 0;
@@ -535,7 +788,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_and_four.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_and_four.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_and_four.avg_ms
-        << "  items=" << query_and_four.items << '\n';
+        << "  items=" << query_and_four.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_or_two_cond...\n";
     sink = 0;
@@ -555,7 +809,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_or_two.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_or_two.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_or_two.avg_ms
-        << "  items=" << query_or_two.items << '\n';
+        << "  items=" << query_or_two.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_or_four_cond...\n";
     sink = 0;
@@ -575,7 +830,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_or_four.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_or_four.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_or_four.avg_ms
-        << "  items=" << query_or_four.items << '\n';
+        << "  items=" << query_or_four.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_not...\n";
     sink = 0;
@@ -597,7 +853,229 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_not.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_not.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_not.avg_ms
-        << "  items=" << query_not.items << '\n';
+        << "  items=" << query_not.items
+        << "  allocs/iter=" << query_not.allocations
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // Same query streamed: one parsed row alive at a time
+    std::cout << "  query_not_stream...\n";
+    sink = 0;
+    BenchResult query_not_stream = run_bench("query_not_stream", config.query_iters, [&]() {
+        sink += csv.for_each(*not_query, [](const dob::DobJobApplication&) { return true; });
+    });
+    query_not_stream.items = sink;
+    out << "  Result: " << query_not_stream.items << " total matches across "
+        << config.query_iters << " iterations ";
+    out << std::left << std::setw(30) << query_not_stream.name
+        << "  iters=" << std::setw(4) << query_not_stream.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_not_stream.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_not_stream.avg_ms
+        << "  items=" << query_not_stream.items
+        << "  allocs/iter=" << query_not_stream.allocations
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // Same query into an arena-backed batch of string_view records
+    std::cout << "  query_not_views...\n";
+    sink = 0;
+    BenchResult query_not_views = run_bench("query_not_views", config.query_iters, [&]() {
+        sink += csv.query_views(*not_query).size();
+    });
+    query_not_views.items = sink;
+    out << "  Result: " << query_not_views.items << " total matches across "
+        << config.query_iters << " iterations ";
+    out << std::left << std::setw(30) << query_not_views.name
+        << "  iters=" << std::setw(4) << query_not_views.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_not_views.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_not_views.avg_ms
+        << "  items=" << query_not_views.items
+        << "  allocs/iter=" << query_not_views.allocations
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // Same query into a struct-of-arrays batch
+    std::cout << "  query_not_batch...\n";
+    sink = 0;
+    BenchResult query_not_batch = run_bench("query_not_batch", config.query_iters, [&]() {
+        sink += csv.query_batch(*not_query).size();
+    });
+    query_not_batch.items = sink;
+    out << "  Result: " << query_not_batch.items << " total matches across "
+        << query_not_batch.iterations << " iterations ";
+    out << std::left << std::setw(30) << query_not_batch.name
+        << "  iters=" << std::setw(4) << query_not_batch.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_not_batch.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_not_batch.avg_ms
+        << "  items=" << query_not_batch.items
+        << "  allocs/iter=" << query_not_batch.allocations
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // Summing two fields over the NOT results: a walk over whole records
+    // against a scan of two arrays
+    {
+        const auto rows = csv.query(*not_query);
+        const auto batch = csv.query_batch(*not_query);
+        const std::size_t aggregate_iters = config.query_iters * 20;
+        int64_t checksum = 0;
+
+        std::cout << "  aggregate_rows...\n";
+        sink = 0;
+        BenchResult aggregate_rows = run_bench("aggregate_rows", aggregate_iters, [&]() {
+            int64_t cost = 0;
+            int64_t units = 0;
+            for (const auto& app : rows) {
+                cost += app.initial_cost_cents;
+                units += app.proposed_dwelling_units;
+            }
+            checksum = cost + units;
+            sink += rows.size();
+        });
+        aggregate_rows.items = sink;
+        out << "  Result: " << aggregate_rows.items << " total matches across "
+            << aggregate_rows.iterations << " iterations ";
+        out << std::left << std::setw(30) << aggregate_rows.name
+            << "  iters=" << std::setw(4) << aggregate_rows.iterations
+            << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << aggregate_rows.total_ms
+            << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << aggregate_rows.avg_ms
+            << "  items=" << aggregate_rows.items
+            << "  sum=" << checksum << '\n';
+
+        std::cout << "  aggregate_batch...\n";
+        sink = 0;
+        BenchResult aggregate_batch = run_bench("aggregate_batch", aggregate_iters, [&]() {
+            int64_t cost = 0;
+            int64_t units = 0;
+            for (int64_t c : batch.initial_cost_cents)
+                cost += c;
+            for (int16_t u : batch.proposed_dwelling_units)
+                units += u;
+            checksum = cost + units;
+            sink += batch.size();
+        });
+        aggregate_batch.items = sink;
+        out << "  Result: " << aggregate_batch.items << " total matches across "
+            << aggregate_batch.iterations << " iterations ";
+        out << std::left << std::setw(30) << aggregate_batch.name
+            << "  iters=" << std::setw(4) << aggregate_batch.iterations
+            << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << aggregate_batch.total_ms
+            << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << aggregate_batch.avg_ms
+            << "  items=" << aggregate_batch.items
+            << "  sum=" << checksum << '\n';
+    }
+
+    // Grouped aggregation over the NOT results: the client-side roll-up of
+    // materialized records against the native GROUP BY fused with the scan
+    {
+        int64_t checksum = 0;
+        std::size_t groups = 0;
+        auto print_group_result = [&](const BenchResult& result) {
+            out << "  Result: " << result.items << " total matches across "
+                << result.iterations << " iterations ";
+            out << std::left << std::setw(30) << result.name
+                << "  iters=" << std::setw(4) << result.iterations
+                << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << result.total_ms
+                << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << result.avg_ms
+                << "  items=" << result.items
+                << "  groups=" << groups
+                << "  sum=" << checksum
+                << "  allocs/iter=" << result.allocations << '\n';
+        };
+
+        std::cout << "  group_by_client...\n";
+        sink = 0;
+        BenchResult group_by_client = run_bench("group_by_client", config.query_iters, [&]() {
+            std::unordered_map<std::string, std::pair<std::size_t, int64_t>> totals;
+            const auto rows = csv.query(*not_query);
+            for (const auto& app : rows) {
+                auto& total = totals[app.job_type];
+                ++total.first;
+                total.second += app.initial_cost_cents;
+            }
+            checksum = 0;
+            for (const auto& [type, total] : totals)
+                checksum += total.second;
+            groups = totals.size();
+            sink += rows.size();
+        });
+        group_by_client.items = sink;
+        print_group_result(group_by_client);
+
+        const query::GroupBy cost_by_type({"job_type"}, {
+            {query::AggregateOp::COUNT, ""},
+            {query::AggregateOp::SUM, "initial_cost_cents"},
+        });
+        std::cout << "  group_by_job_type...\n";
+        sink = 0;
+        BenchResult group_by_job_type = run_bench("group_by_job_type", config.query_iters, [&]() {
+            const auto result = csv.aggregate(*not_query, cost_by_type);
+            checksum = 0;
+            for (const auto& group : result)
+                checksum += static_cast<int64_t>(group.values[1].value_or(0.0));
+            groups = result.size();
+            sink += csv.last_query_stats().rows_matched;
+        });
+        group_by_job_type.items = sink;
+        print_group_result(group_by_job_type);
+
+        const query::GroupBy units_by_nta({"nta_name"}, {
+            {query::AggregateOp::AVG, "proposed_dwelling_units"},
+        });
+        std::cout << "  group_by_nta_avg_units...\n";
+        sink = 0;
+        BenchResult group_by_nta = run_bench("group_by_nta_avg_units", config.query_iters, [&]() {
+            const auto result = csv.aggregate(*not_query, units_by_nta);
+            checksum = 0;
+            groups = result.size();
+            sink += csv.last_query_stats().rows_matched;
+        });
+        group_by_nta.items = sink;
+        print_group_result(group_by_nta);
+
+        const query::GroupBy count_by_board({"borough", "community_board"}, {
+            {query::AggregateOp::COUNT, ""},
+        });
+        std::cout << "  group_by_borough_board...\n";
+        sink = 0;
+        BenchResult group_by_board = run_bench("group_by_borough_board", config.query_iters, [&]() {
+            const auto result = csv.aggregate(*not_query, count_by_board);
+            checksum = 0;
+            groups = result.size();
+            sink += csv.last_query_stats().rows_matched;
+        });
+        group_by_board.items = sink;
+        print_group_result(group_by_board);
+    }
+
+    // Time to the first rows: the scan stops after the limit
+    std::cout << "  query_not_limit_100...\n";
+    sink = 0;
+    BenchResult query_not_limit = run_bench("query_not_limit_100", config.query_iters, [&]() {
+        sink += csv.query(*not_query, 100).size();
+    });
+    query_not_limit.items = sink;
+    out << "  Result: " << query_not_limit.items << " total matches across "
+        << config.query_iters << " iterations ";
+    out << std::left << std::setw(30) << query_not_limit.name
+        << "  iters=" << std::setw(4) << query_not_limit.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_not_limit.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_not_limit.avg_ms
+        << "  items=" << query_not_limit.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // Same query materializing three columns instead of whole rows
+    std::cout << "  query_not_projected...\n";
+    sink = 0;
+    const query::Projection not_projection({"job_number", "borough", "filing_date"});
+    BenchResult query_not_projected = run_bench("query_not_projected", config.query_iters, [&]() {
+        sink += csv.query(*not_query, not_projection).size();
+    });
+    query_not_projected.items = sink;
+    out << "  Result: " << query_not_projected.items << " total matches across "
+        << config.query_iters << " iterations ";
+    out << std::left << std::setw(30) << query_not_projected.name
+        << "  iters=" << std::setw(4) << query_not_projected.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_not_projected.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_not_projected.avg_ms
+        << "  items=" << query_not_projected.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_complex_nested...\n";
     sink = 0;
@@ -617,7 +1095,58 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_complex_nested.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_complex_nested.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_complex_nested.avg_ms
-        << "  items=" << query_complex_nested.items << '\n';
+        << "  items=" << query_complex_nested.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+    out << "  Plan after " << config.query_iters << " iterations:\n" << complex_nested_query->explain();
+
+    // count() of the same query, then against a file with a result cache:
+    // its first iteration scans, the rest only count the cached row ids
+    {
+        CsvIndexedFileOptions cached_options = csv_options;
+        cached_options.result_cache_bytes = std::size_t{64} << 20;
+        CsvIndexedFile cached_csv(csv_path.string(), cached_options);
+
+        for (CsvIndexedFile* file : {&csv, &cached_csv}) {
+            const bool cached = file == &cached_csv;
+            const char* name = cached ? "count_complex_cached" : "count_complex_nested";
+            std::cout << "  " << name << "...\n";
+            sink = 0;
+            auto count_query = make_complex_nested_query();
+            BenchResult count_complex = run_bench(name, config.query_iters, [&]() {
+                sink += file->count(*count_query);
+            });
+            count_complex.items = sink;
+            out << std::left << std::setw(30) << count_complex.name
+                << "  iters=" << std::setw(4) << count_complex.iterations
+                << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << count_complex.total_ms
+                << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << count_complex.avg_ms
+                << "  items=" << count_complex.items;
+            if (cached) {
+                const CsvResultCacheStats& cache = cached_csv.result_cache_stats();
+                out << "  hits=" << cache.hits << "  misses=" << cache.misses
+                    << "  cache_kb=" << cache.bytes / 1024;
+            }
+            out << '\n';
+        }
+
+        // A nested empty AND matches nothing, so it must not share a cache
+        // entry with its flattened twin
+        std::cout << "  count_empty_and_cached...\n";
+        query::MatchQuery queens("borough", "QUEENS");
+        std::vector<std::unique_ptr<query::Query>> with_empty;
+        with_empty.emplace_back(std::make_unique<query::MatchQuery>("borough", "QUEENS"));
+        with_empty.emplace_back(std::make_unique<query::AndQuery>(std::vector<std::unique_ptr<query::Query>>{}));
+        query::AndQuery empty_and(std::move(with_empty));
+
+        const std::size_t twin = cached_csv.count(queens);
+        const std::size_t nested = cached_csv.count(empty_and);
+        if (nested != 0) {
+            std::cerr << "ERROR: count_empty_and_cached returned " << nested << " rows\n";
+            std::exit(1);
+        }
+        out << std::left << std::setw(30) << "count_empty_and_cached"
+            << "  twin=" << twin << "  nested=" << nested << '\n';
+    }
 
     std::cout << "  query_range_heavy...\n";
     sink = 0;
@@ -637,7 +1166,8 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_range_heavy.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_range_heavy.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_range_heavy.avg_ms
-        << "  items=" << query_range_heavy.items << '\n';
+        << "  items=" << query_range_heavy.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
 
     std::cout << "  query_mixed...\n";
     sink = 0;
@@ -657,7 +1187,73 @@ int main(int argc, char** argv)
         << "  iters=" << std::setw(4) << query_mixed.iterations
         << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_mixed.total_ms
         << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_mixed.avg_ms
-        << "  items=" << query_mixed.items << '\n';
+        << "  items=" << query_mixed.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // The synthetic CSV carries no dates, so an empty result is not an error
+    std::cout << "  query_date_window...\n";
+    sink = 0;
+    auto date_window_query = make_date_window_query();
+    BenchResult query_date_window = run_bench("query_date_window", config.query_iters, [&]() {
+        sink += csv.query(*date_window_query).size();
+    });
+    query_date_window.items = sink;
+    out << "  Result: " << query_date_window.items << " total matches across "
+        << config.query_iters << " iterations ";
+    out << std::left << std::setw(30) << query_date_window.name
+        << "  iters=" << std::setw(4) << query_date_window.iterations
+        << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << query_date_window.total_ms
+        << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << query_date_window.avg_ms
+        << "  items=" << query_date_window.items
+        << "  skipped=" << format_skip_rate(csv.last_query_stats()) << '\n';
+
+    // Every query pattern above as one batch: one query() call each, then
+    // one shared pass through query_many()
+    {
+        std::vector<std::unique_ptr<query::Query>> batch;
+        batch.push_back(make_simple_match_query());
+        batch.push_back(make_simple_range_query());
+        batch.push_back(make_simple_string_match_query());
+        batch.push_back(make_and_query_two_conditions());
+        batch.push_back(make_and_query_three_conditions());
+        batch.push_back(make_and_query_four_conditions());
+        batch.push_back(make_or_query_two_conditions());
+        batch.push_back(make_or_query_four_conditions());
+        batch.push_back(make_not_query());
+        batch.push_back(make_complex_nested_query());
+        batch.push_back(make_range_heavy_query());
+        batch.push_back(make_mixed_query());
+        batch.push_back(make_date_window_query());
+
+        std::vector<query::Query*> batch_ptrs;
+        for (const auto& q : batch)
+            batch_ptrs.push_back(q.get());
+
+        std::cout << "  query_batch_separate...\n";
+        sink = 0;
+        BenchResult query_batch_separate = run_bench("query_batch_separate", config.query_iters, [&]() {
+            for (query::Query* q : batch_ptrs)
+                sink += csv.query(*q).size();
+        });
+        query_batch_separate.items = sink;
+
+        std::cout << "  query_many...\n";
+        sink = 0;
+        BenchResult query_many = run_bench("query_many", config.query_iters, [&]() {
+            for (const auto& results : csv.query_many(batch_ptrs))
+                sink += results.size();
+        });
+        query_many.items = sink;
+
+        for (const BenchResult* result : {&query_batch_separate, &query_many}) {
+            out << std::left << std::setw(30) << result->name
+                << "  iters=" << std::setw(4) << result->iterations
+                << "  total_ms=" << std::setw(10) << std::fixed << std::setprecision(2) << result->total_ms
+                << "  avg_ms=" << std::setw(8) << std::fixed << std::setprecision(2) << result->avg_ms
+                << "  items=" << result->items
+                << "  queries=" << batch_ptrs.size() << '\n';
+        }
+    }
 
     out << "\n======================================================\n";
     out << "Benchmarks complete!\n";
@@ -10,7 +10,7 @@ namespace {
 
 std::unique_ptr<query::Query> make_simple_match_query()
 {
-    return std::make_unique<query::MatchQuery>("borough", std::any(1.0));
+    return std::make_unique<query::MatchQuery>("borough", "BROOKLYN");
 }
 
 } // namespace
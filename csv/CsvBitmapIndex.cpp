@@ -0,0 +1,163 @@
+#include "CsvBitmapIndex.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+// ---------- build ----------
+
+void CsvBitmapIndex::build(const std::string& path, const CsvColumnCache& columns,
+                           uint64_t fileSize)
+{
+    const std::size_t rows = columns.row_count();
+
+    std::vector<CsvBitmapEntry> entries;
+    std::vector<std::vector<char>> blobs;
+
+    auto add_bitmaps = [&](int column, std::vector<query::RowBitmap>& bitmaps) {
+        for (uint32_t code = 0; code < bitmaps.size(); ++code) {
+            CsvBitmapEntry e;
+            e.csv_column = static_cast<uint32_t>(column);
+            e.code = code;
+            blobs.emplace_back();
+            bitmaps[code].serialize(blobs.back());
+            e.size = blobs.back().size();
+            entries.push_back(e);
+        }
+    };
+
+    for (int column = 0; column < columns.column_limit(); ++column) {
+        const auto* entry = columns.column(column);
+        if (!entry)
+            continue;
+
+        std::vector<query::RowBitmap> bitmaps;
+        const auto encoding = static_cast<ColumnEncoding>(entry->encoding);
+
+        if (encoding == ColumnEncoding::DICT) {
+            if (columns.dictionary_size(column) > kMaxCardinality)
+                continue;
+            bitmaps.resize(columns.dictionary_size(column));
+            const uint32_t* codes = columns.codes(column);
+            for (std::size_t r = 0; r < rows; ++r) {
+                if (column < columns.field_count(r))
+                    bitmaps[codes[r]].add(static_cast<uint32_t>(r));
+            }
+        } else if (encoding == ColumnEncoding::BITMAP) {
+            bitmaps.resize(2);
+            for (std::size_t r = 0; r < rows; ++r) {
+                if (column < columns.field_count(r))
+                    bitmaps[columns.flag(r, column) ? 1 : 0].add(static_cast<uint32_t>(r));
+            }
+        } else {
+            continue;
+        }
+
+        add_bitmaps(column, bitmaps);
+    }
+
+    CsvBitmapIndexHeader h;
+    h.file_size = fileSize;
+    h.row_count = rows;
+    h.entry_count = entries.size();
+
+    uint64_t offset = sizeof(h) + entries.size() * sizeof(CsvBitmapEntry);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        entries[i].offset = offset;
+        offset += entries[i].size;
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to write bitmap index");
+
+    // The header is written last; until then the index fails to load and
+    // an interrupted build is redone on the next open
+    CsvBitmapIndexHeader pending;
+    pending.magic = 0;
+    out.write(reinterpret_cast<const char*>(&pending), sizeof(pending));
+    out.write(reinterpret_cast<const char*>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(CsvBitmapEntry)));
+    for (const auto& blob : blobs)
+        out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+
+    out.flush();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write bitmap index");
+}
+
+// ---------- load ----------
+
+bool CsvBitmapIndex::load(const std::string& path, uint64_t fileSize, uint64_t rowCount)
+{
+    {
+        CsvBitmapIndexHeader h{};
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (!in)
+            return false;
+
+        const CsvBitmapIndexHeader expected{};
+        if (h.magic != expected.magic) return false;
+        if (h.version != expected.version) return false;
+        if (h.file_size != fileSize) return false;
+        if (h.row_count != rowCount) return false;
+    }
+
+    map_.open(path);
+    header_ = reinterpret_cast<const CsvBitmapIndexHeader*>(map_.data());
+    entries_ = reinterpret_cast<const CsvBitmapEntry*>(map_.data() + sizeof(CsvBitmapIndexHeader));
+
+    if (!entries_fit()) {
+        map_.close();
+        header_ = nullptr;
+        entries_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// The directory and every bitmap it points at lie in the file
+bool CsvBitmapIndex::entries_fit() const
+{
+    const uint64_t size = map_.size();
+    if (header_->entry_count > (size - sizeof(CsvBitmapIndexHeader)) / sizeof(CsvBitmapEntry))
+        return false;
+
+    for (uint64_t i = 0; i < header_->entry_count; ++i) {
+        if (entries_[i].offset > size || entries_[i].size > size - entries_[i].offset)
+            return false;
+    }
+    return true;
+}
+
+// ---------- lookup ----------
+
+std::size_t CsvBitmapIndex::row_count() const
+{
+    return header_ ? static_cast<std::size_t>(header_->row_count) : 0;
+}
+
+std::optional<query::RowBitmap> CsvBitmapIndex::value_rows(int column, uint32_t code) const
+{
+    if (!header_ || column < 0)
+        return std::nullopt;
+
+    const auto* end = entries_ + header_->entry_count;
+    const auto key = std::make_pair(static_cast<uint32_t>(column), code);
+    const auto* it = std::lower_bound(entries_, end, key,
+        [](const CsvBitmapEntry& e, const std::pair<uint32_t, uint32_t>& k) {
+            return std::make_pair(e.csv_column, e.code) < k;
+        });
+
+    if (it == end || it->csv_column != key.first || it->code != key.second)
+        return std::nullopt;
+
+    return query::RowBitmap::deserialize(map_.data() + it->offset,
+                                         static_cast<std::size_t>(it->size));
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "CsvColumnCache.hpp"
+#include "MappedFile.hpp"
+#include "../query/Querys.hpp"
+
+// Persisted per-value row bitmaps (<csv>.bmp) for the low-cardinality
+// columns of the column cache: dictionary columns with few distinct values
+// and boolean flags. Invalidated like the row index.
+struct CsvBitmapIndexHeader {
+    uint64_t magic = 0x435356424D503031ULL; // CSVBMP01
+    uint64_t version = 2;
+    uint64_t file_size = 0;
+    uint64_t row_count = 0;
+    uint64_t entry_count = 0;
+};
+
+// One bitmap; entries are sorted by (csv_column, code)
+struct CsvBitmapEntry {
+    uint32_t csv_column = 0;
+    uint32_t code = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+class CsvBitmapIndex : public query::IndexSource {
+public:
+    // Dictionary columns with more distinct values than this are not indexed
+    static constexpr std::size_t kMaxCardinality = 256;
+
+    static void build(const std::string& path, const CsvColumnCache& columns,
+                      uint64_t fileSize);
+
+    bool load(const std::string& path, uint64_t fileSize, uint64_t rowCount);
+    bool is_loaded() const { return map_.is_open(); }
+
+    std::size_t row_count() const override;
+    std::optional<query::RowBitmap> value_rows(int column, uint32_t code) const override;
+
+private:
+    MappedFile map_;
+    const CsvBitmapIndexHeader* header_ = nullptr;
+    const CsvBitmapEntry* entries_ = nullptr;
+
+    bool entries_fit() const;
+};
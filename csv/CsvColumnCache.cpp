@@ -0,0 +1,562 @@
+#include "CsvColumnCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "../dob/DobCsv.hpp"
+#include "../dob/DobParseUtils.hpp"
+
+namespace {
+
+struct ColumnBuilder {
+    int csv_column = 0;
+    dob::ColumnCategory category = dob::ColumnCategory::STRING;
+
+    std::vector<double> numbers;
+    bool integral = true;
+    std::vector<dob::Date> dates;
+    std::vector<uint64_t> bits;
+    std::vector<uint32_t> codes;
+    std::unordered_map<std::string, uint32_t> dict;
+    std::vector<const std::string*> dict_keys;   // code -> key in dict
+
+    // Statistics over the rows that hold the field
+    uint64_t present = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    uint64_t true_count = 0;
+    std::vector<uint32_t> code_rows;             // code -> rows
+    std::string unescaped;                       // scratch for field_text
+
+    void observe(double value)
+    {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void add(std::size_t row, std::optional<std::string_view> raw)
+    {
+        if (raw)
+            ++present;
+
+        switch (category) {
+            case dob::ColumnCategory::NUMERIC: {
+                const double value = raw ? dob::parse_number(*raw, csv_column) : 0.0;
+                integral = integral
+                    && value == std::trunc(value)
+                    && value >= std::numeric_limits<int32_t>::min()
+                    && value <= std::numeric_limits<int32_t>::max();
+                numbers.push_back(value);
+                if (raw)
+                    observe(value);
+                break;
+            }
+            case dob::ColumnCategory::DATE: {
+                const dob::Date value = raw ? dob::parse_date(dob::unquote(*raw)) : 0;
+                dates.push_back(value);
+                if (raw)
+                    observe(value);
+                break;
+            }
+            case dob::ColumnCategory::BOOLEAN:
+                if (row % 64 == 0)
+                    bits.push_back(0);
+                if (raw && dob::parse_flag(*raw)) {
+                    bits.back() |= uint64_t{1} << (row % 64);
+                    ++true_count;
+                }
+                break;
+            case dob::ColumnCategory::STRING: {
+                const std::string_view value = raw ? dob::field_text(*raw, unescaped) : std::string_view{};
+                auto [it, inserted] = dict.try_emplace(std::string(value),
+                                                       static_cast<uint32_t>(dict.size()));
+                if (inserted) {
+                    dict_keys.push_back(&it->first);
+                    code_rows.push_back(0);
+                }
+                codes.push_back(it->second);
+                if (raw)
+                    ++code_rows[it->second];
+                break;
+            }
+        }
+    }
+
+    // Distinct count and equi-depth bucket boundaries of the present values
+    template <typename T>
+    void summarize(const std::vector<T>& values, const std::vector<uint16_t>& field_counts,
+                   uint64_t& distinct, std::vector<double>& quantiles) const
+    {
+        std::vector<double> sorted;
+        sorted.reserve(static_cast<std::size_t>(present));
+        for (std::size_t r = 0; r < values.size(); ++r) {
+            if (csv_column < field_counts[r])
+                sorted.push_back(static_cast<double>(values[r]));
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        quantiles.clear();
+        if (sorted.empty()) {
+            distinct = 0;
+            return;
+        }
+        constexpr std::size_t buckets = CsvColumnCache::kHistogramBuckets;
+        for (std::size_t b = 0; b <= buckets; ++b)
+            quantiles.push_back(sorted[(sorted.size() - 1) * b / buckets]);
+
+        distinct = static_cast<uint64_t>(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+    }
+
+    // Renumber the dictionary in sorted order so code order matches string order
+    void sort_dictionary()
+    {
+        std::vector<uint32_t> order(dict_keys.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return *dict_keys[a] < *dict_keys[b];
+        });
+
+        std::vector<uint32_t> remap(order.size());
+        std::vector<const std::string*> sorted(order.size());
+        std::vector<uint32_t> sorted_rows(order.size());
+        for (uint32_t code = 0; code < order.size(); ++code) {
+            remap[order[code]] = code;
+            sorted[code] = dict_keys[order[code]];
+            sorted_rows[code] = code_rows[order[code]];
+        }
+
+        for (auto& c : codes)
+            c = remap[c];
+        dict_keys = std::move(sorted);
+        code_rows = std::move(sorted_rows);
+    }
+};
+
+// Every distinct CSV column referenced by COLUMN_SCHEMA, by index
+std::vector<std::pair<int, dob::ColumnCategory>> cached_columns()
+{
+    std::map<int, dob::ColumnCategory> by_index;
+    for (const auto& column : dob::COLUMN_SCHEMA)
+        by_index.emplace(column.csv_index, column.category);
+    return {by_index.begin(), by_index.end()};
+}
+
+class SectionWriter {
+public:
+    explicit SectionWriter(std::ofstream& out) : out_(out) {}
+
+    uint64_t position() const { return pos_; }
+
+    // Start a new section on an 8-byte boundary and return its offset
+    uint64_t begin_section()
+    {
+        static const char zeros[8] = {};
+        const uint64_t pad = (8 - pos_ % 8) % 8;
+        write(zeros, pad);
+        return pos_;
+    }
+
+    void write(const void* data, uint64_t bytes)
+    {
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        pos_ += bytes;
+    }
+
+    template <typename T>
+    uint64_t write_array(const std::vector<T>& values)
+    {
+        const uint64_t offset = begin_section();
+        write(values.data(), values.size() * sizeof(T));
+        return offset;
+    }
+
+private:
+    std::ofstream& out_;
+    uint64_t pos_ = 0;
+};
+
+} // namespace
+
+// ---------- build ----------
+
+void CsvColumnCache::build(const std::string& path, uint64_t fileSize,
+                           std::size_t rowCount, const RowFn& row)
+{
+    const auto columns = cached_columns();
+    const int max_column = columns.back().first;
+
+    std::vector<ColumnBuilder> builders(columns.size());
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        builders[c].csv_column = columns[c].first;
+        builders[c].category = columns[c].second;
+    }
+
+    std::vector<uint16_t> field_counts(rowCount);
+    std::vector<std::string_view> fields;
+
+    for (std::size_t i = 0; i < rowCount; ++i) {
+        dob::split_csv_line(row(i), fields, static_cast<std::size_t>(max_column) + 1);
+        field_counts[i] = static_cast<uint16_t>(fields.size());
+
+        for (auto& b : builders) {
+            std::optional<std::string_view> raw;
+            if (b.csv_column < static_cast<int>(fields.size()))
+                raw = fields[static_cast<std::size_t>(b.csv_column)];
+            b.add(i, raw);
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to write column cache");
+
+    CsvColumnCacheHeader h;
+    h.file_size = fileSize;
+    h.row_count = rowCount;
+    h.column_count = builders.size();
+    std::vector<CsvColumnEntry> entries(builders.size());
+
+    // Directory and header are rewritten once the section offsets are
+    // known, the header last; until then the cache fails to load and an
+    // interrupted build is redone on the next open
+    CsvColumnCacheHeader pending;
+    pending.magic = 0;
+    SectionWriter w(out);
+    w.write(&pending, sizeof(pending));
+    w.write(entries.data(), entries.size() * sizeof(CsvColumnEntry));
+
+    h.field_counts_offset = w.write_array(field_counts);
+
+    std::vector<double> quantiles;
+    for (std::size_t c = 0; c < builders.size(); ++c) {
+        auto& b = builders[c];
+        auto& e = entries[c];
+        quantiles.clear();
+        e.csv_column = static_cast<uint32_t>(b.csv_column);
+        e.present_count = b.present;
+        if (b.present > 0) {
+            e.min_value = b.min;
+            e.max_value = b.max;
+        }
+
+        switch (b.category) {
+            case dob::ColumnCategory::NUMERIC:
+                if (b.integral) {
+                    std::vector<int32_t> packed(b.numbers.begin(), b.numbers.end());
+                    e.encoding = static_cast<uint32_t>(ColumnEncoding::I32);
+                    e.values_offset = w.write_array(packed);
+                } else {
+                    e.encoding = static_cast<uint32_t>(ColumnEncoding::F64);
+                    e.values_offset = w.write_array(b.numbers);
+                }
+                b.summarize(b.numbers, field_counts, e.distinct_count, quantiles);
+                break;
+            case dob::ColumnCategory::DATE:
+                e.encoding = static_cast<uint32_t>(ColumnEncoding::DATE);
+                e.values_offset = w.write_array(b.dates);
+                b.summarize(b.dates, field_counts, e.distinct_count, quantiles);
+                break;
+            case dob::ColumnCategory::BOOLEAN:
+                e.encoding = static_cast<uint32_t>(ColumnEncoding::BITMAP);
+                e.values_offset = w.write_array(b.bits);
+                e.true_count = b.true_count;
+                e.distinct_count = (b.true_count > 0 ? 1 : 0) + (b.true_count < b.present ? 1 : 0);
+                break;
+            case dob::ColumnCategory::STRING: {
+                b.sort_dictionary();
+                e.encoding = static_cast<uint32_t>(ColumnEncoding::DICT);
+                e.values_offset = w.write_array(b.codes);
+                e.dict_count = b.dict_keys.size();
+                e.distinct_count = b.dict_keys.size();
+                e.dict_rows_offset = w.write_array(b.code_rows);
+
+                std::vector<uint64_t> offsets;
+                offsets.reserve(b.dict_keys.size() + 1);
+                uint64_t heap = 0;
+                for (const auto* key : b.dict_keys) {
+                    offsets.push_back(heap);
+                    heap += key->size();
+                }
+                offsets.push_back(heap);
+                e.dict_offsets_offset = w.write_array(offsets);
+
+                e.dict_bytes_offset = w.begin_section();
+                for (const auto* key : b.dict_keys)
+                    w.write(key->data(), key->size());
+                break;
+            }
+        }
+
+        if (!quantiles.empty())
+            e.quantiles_offset = w.write_array(quantiles);
+
+        // Release the column's build state before moving on to the next
+        b = ColumnBuilder{};
+    }
+
+    out.seekp(sizeof(h));
+    out.write(reinterpret_cast<const char*>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(CsvColumnEntry)));
+    out.flush();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write column cache");
+}
+
+// ---------- load ----------
+
+bool CsvColumnCache::load(const std::string& path, uint64_t fileSize, uint64_t rowCount)
+{
+    {
+        CsvColumnCacheHeader h{};
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (!in)
+            return false;
+
+        const CsvColumnCacheHeader expected{};
+        if (h.magic != expected.magic) return false;
+        if (h.version != expected.version) return false;
+        if (h.file_size != fileSize) return false;
+        if (h.row_count != rowCount) return false;
+    }
+
+    map_.open(path);
+    header_ = section<CsvColumnCacheHeader>(0);
+    if (!sections_fit()) {
+        map_.close();
+        header_ = nullptr;
+        return false;
+    }
+    field_counts_ = section<uint16_t>(header_->field_counts_offset);
+
+    const auto* entries = section<CsvColumnEntry>(sizeof(CsvColumnCacheHeader));
+    columns_.clear();
+    for (uint64_t c = 0; c < header_->column_count; ++c) {
+        const auto column = static_cast<std::size_t>(entries[c].csv_column);
+        if (column >= columns_.size())
+            columns_.resize(column + 1, nullptr);
+        columns_[column] = &entries[c];
+    }
+
+    return true;
+}
+
+// Every section the header and the directory point at lies in the file
+bool CsvColumnCache::sections_fit() const
+{
+    const uint64_t size = map_.size();
+    const uint64_t rows = header_->row_count;
+
+    // count elements of width bytes at offset
+    auto fits = [size](uint64_t offset, uint64_t count, uint64_t width) {
+        return offset <= size && count <= (size - offset) / width;
+    };
+
+    if (!fits(sizeof(CsvColumnCacheHeader), header_->column_count, sizeof(CsvColumnEntry)))
+        return false;
+    if (!fits(header_->field_counts_offset, rows, sizeof(uint16_t)))
+        return false;
+
+    const auto* entries = section<CsvColumnEntry>(sizeof(CsvColumnCacheHeader));
+    for (uint64_t c = 0; c < header_->column_count; ++c) {
+        const CsvColumnEntry& e = entries[c];
+        if (e.csv_column > static_cast<uint32_t>(std::numeric_limits<uint16_t>::max()))
+            return false;
+
+        bool ok = false;
+        switch (static_cast<ColumnEncoding>(e.encoding)) {
+            case ColumnEncoding::F64:
+                ok = fits(e.values_offset, rows, sizeof(double));
+                break;
+            case ColumnEncoding::I32:
+                ok = fits(e.values_offset, rows, sizeof(int32_t));
+                break;
+            case ColumnEncoding::DATE:
+                ok = fits(e.values_offset, rows, sizeof(dob::Date));
+                break;
+            case ColumnEncoding::BITMAP:
+                ok = fits(e.values_offset, (rows + 63) / 64, sizeof(uint64_t));
+                break;
+            case ColumnEncoding::DICT:
+                ok = fits(e.values_offset, rows, sizeof(uint32_t))
+                    && e.dict_count < std::numeric_limits<uint32_t>::max()
+                    && fits(e.dict_rows_offset, e.dict_count, sizeof(uint32_t))
+                    && fits(e.dict_offsets_offset, e.dict_count + 1, sizeof(uint64_t))
+                    && fits(e.dict_bytes_offset,
+                            section<uint64_t>(e.dict_offsets_offset)[e.dict_count], 1);
+                break;
+        }
+        if (!ok)
+            return false;
+
+        if (e.quantiles_offset != 0 && !fits(e.quantiles_offset, kHistogramBuckets + 1, sizeof(double)))
+            return false;
+    }
+    return true;
+}
+
+// ---------- access ----------
+
+std::size_t CsvColumnCache::row_count() const
+{
+    return header_ ? static_cast<std::size_t>(header_->row_count) : 0;
+}
+
+const CsvColumnEntry* CsvColumnCache::column(int csvColumn) const
+{
+    if (csvColumn < 0 || static_cast<std::size_t>(csvColumn) >= columns_.size())
+        return nullptr;
+    return columns_[static_cast<std::size_t>(csvColumn)];
+}
+
+int CsvColumnCache::field_count(std::size_t row) const
+{
+    return field_counts_[row];
+}
+
+std::string_view CsvColumnCache::dict_value(const CsvColumnEntry& entry, uint32_t code) const
+{
+    const auto* offsets = section<uint64_t>(entry.dict_offsets_offset);
+    const char* bytes = map_.data() + entry.dict_bytes_offset;
+    return {bytes + offsets[code], static_cast<std::size_t>(offsets[code + 1] - offsets[code])};
+}
+
+std::string_view CsvColumnCache::text(std::size_t row, int column) const
+{
+    const auto* e = this->column(column);
+    if (!e || e->encoding != static_cast<uint32_t>(ColumnEncoding::DICT))
+        return {};
+    return dict_value(*e, section<uint32_t>(e->values_offset)[row]);
+}
+
+double CsvColumnCache::number(std::size_t row, int column) const
+{
+    const auto* e = this->column(column);
+    if (!e)
+        return 0.0;
+
+    switch (static_cast<ColumnEncoding>(e->encoding)) {
+        case ColumnEncoding::F64:
+            return section<double>(e->values_offset)[row];
+        case ColumnEncoding::I32:
+            return section<int32_t>(e->values_offset)[row];
+        case ColumnEncoding::DATE:
+            return section<dob::Date>(e->values_offset)[row];
+        default:
+            return 0.0;
+    }
+}
+
+bool CsvColumnCache::flag(std::size_t row, int column) const
+{
+    const auto* e = this->column(column);
+    if (!e || e->encoding != static_cast<uint32_t>(ColumnEncoding::BITMAP))
+        return false;
+    return (section<uint64_t>(e->values_offset)[row / 64] >> (row % 64)) & 1u;
+}
+
+dob::Date CsvColumnCache::date(std::size_t row, int column) const
+{
+    const auto* e = this->column(column);
+    if (!e || e->encoding != static_cast<uint32_t>(ColumnEncoding::DATE))
+        return 0;
+    return section<dob::Date>(e->values_offset)[row];
+}
+
+bool CsvColumnCache::has_codes(int column) const
+{
+    const auto* e = this->column(column);
+    return e && e->encoding == static_cast<uint32_t>(ColumnEncoding::DICT);
+}
+
+query::ColumnArray CsvColumnCache::column_array(int column) const
+{
+    const auto* e = this->column(column);
+    if (!e)
+        return {};
+
+    using Type = query::ColumnArray::Type;
+    const void* values = map_.data() + e->values_offset;
+    switch (static_cast<ColumnEncoding>(e->encoding)) {
+        case ColumnEncoding::F64: return {Type::F64, values};
+        case ColumnEncoding::I32: return {Type::I32, values};
+        case ColumnEncoding::DATE: return {Type::DATE, values};
+        case ColumnEncoding::BITMAP: return {Type::BITMAP, values};
+        case ColumnEncoding::DICT: return {Type::CODES, values};
+    }
+    return {};
+}
+
+const uint32_t* CsvColumnCache::codes(int column) const
+{
+    return has_codes(column) ? section<uint32_t>(this->column(column)->values_offset) : nullptr;
+}
+
+uint32_t CsvColumnCache::code(std::size_t row, int column) const
+{
+    return section<uint32_t>(this->column(column)->values_offset)[row];
+}
+
+std::size_t CsvColumnCache::dictionary_size(int column) const
+{
+    return has_codes(column) ? static_cast<std::size_t>(this->column(column)->dict_count) : 0;
+}
+
+std::string_view CsvColumnCache::dictionary_value(int column, uint32_t code) const
+{
+    return dict_value(*this->column(column), code);
+}
+
+uint32_t CsvColumnCache::lower_code(int column, std::string_view value) const
+{
+    const auto* e = this->column(column);
+    uint32_t lo = 0;
+    uint32_t hi = static_cast<uint32_t>(e->dict_count);
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        if (dict_value(*e, mid) < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// ---------- statistics ----------
+
+std::optional<query::ColumnStats> CsvColumnCache::stats(int column) const
+{
+    const auto* e = this->column(column);
+    if (!e)
+        return std::nullopt;
+
+    query::ColumnStats s;
+    s.rows = row_count();
+    s.present = static_cast<std::size_t>(e->present_count);
+    s.distinct = static_cast<std::size_t>(e->distinct_count);
+    s.min = e->min_value;
+    s.max = e->max_value;
+    s.true_rows = static_cast<std::size_t>(e->true_count);
+    if (e->quantiles_offset != 0) {
+        const double* q = section<double>(e->quantiles_offset);
+        s.quantiles.assign(q, q + kHistogramBuckets + 1);
+    }
+    return s;
+}
+
+std::size_t CsvColumnCache::code_rows(int column, uint32_t code) const
+{
+    if (!has_codes(column))
+        return 0;
+    return section<uint32_t>(this->column(column)->dict_rows_offset)[code];
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "../query/Querys.hpp"
+
+// Columnar sidecar (<csv>.cols) holding every COLUMN_SCHEMA column already
+// parsed. Invalidated the same way as the row index: by magic, version and
+// the size of the CSV it was built from.
+struct CsvColumnCacheHeader {
+    uint64_t magic = 0x435356434F4C3031ULL; // CSVCOL01
+    uint64_t version = 5;
+    uint64_t file_size = 0;
+    uint64_t row_count = 0;
+    uint64_t column_count = 0;
+    uint64_t field_counts_offset = 0;   // uint16_t[row_count]
+};
+
+enum class ColumnEncoding : uint32_t {
+    F64 = 0,        // double[row_count]
+    I32 = 1,        // int32_t[row_count], numeric column with only small integers
+    DATE = 2,       // dob::Date[row_count]
+    BITMAP = 3,     // uint64_t[(row_count + 63) / 64]
+    DICT = 4,       // uint32_t codes[row_count] into a sorted dictionary
+};
+
+struct CsvColumnEntry {
+    uint32_t csv_column = 0;
+    uint32_t encoding = 0;
+    uint64_t values_offset = 0;
+    uint64_t dict_count = 0;            // DICT: distinct values
+    uint64_t dict_offsets_offset = 0;   // DICT: uint64_t[dict_count + 1] into the heap
+    uint64_t dict_bytes_offset = 0;     // DICT: concatenated value bytes
+
+    // Planner statistics gathered while building
+    uint64_t present_count = 0;         // rows holding the field
+    uint64_t distinct_count = 0;
+    double min_value = 0.0;             // F64 / I32 / DATE, over present rows
+    double max_value = 0.0;
+    uint64_t true_count = 0;            // BITMAP
+    uint64_t dict_rows_offset = 0;      // DICT: uint32_t[dict_count] rows per code
+    uint64_t quantiles_offset = 0;      // F64 / I32 / DATE: double[kHistogramBuckets + 1]
+};
+
+class CsvColumnCache : public query::ColumnSource {
+public:
+    // Equi-depth buckets kept per numeric and date column for the planner
+    static constexpr std::size_t kHistogramBuckets = 32;
+
+    // Reads row i of the CSV (without its terminator)
+    using RowFn = std::function<std::string_view(std::size_t)>;
+
+    // Parse every row once and write the cache to path
+    static void build(const std::string& path, uint64_t fileSize,
+                      std::size_t rowCount, const RowFn& row);
+
+    // Map an existing cache; false if it is missing or was built for a
+    // different version of the CSV
+    bool load(const std::string& path, uint64_t fileSize, uint64_t rowCount);
+
+    bool is_loaded() const { return map_.is_open(); }
+    std::size_t row_count() const;
+
+    // The entry for a CSV column, or nullptr if it is not cached
+    const CsvColumnEntry* column(int csvColumn) const;
+    // One past the highest cached CSV column
+    int column_limit() const { return static_cast<int>(columns_.size()); }
+
+    int field_count(std::size_t row) const override;
+    std::string_view text(std::size_t row, int column) const override;
+    double number(std::size_t row, int column) const override;
+    bool flag(std::size_t row, int column) const override;
+    dob::Date date(std::size_t row, int column) const override;
+
+    bool has_codes(int column) const override;
+    uint32_t code(std::size_t row, int column) const override;
+    std::size_t dictionary_size(int column) const override;
+    std::string_view dictionary_value(int column, uint32_t code) const override;
+    uint32_t lower_code(int column, std::string_view value) const override;
+
+    std::optional<query::ColumnStats> stats(int column) const override;
+    std::size_t code_rows(int column, uint32_t code) const override;
+
+    query::ColumnArray column_array(int column) const override;
+    const uint16_t* field_counts() const override { return field_counts_; }
+
+    // Raw code array of a dictionary column (row_count() entries)
+    const uint32_t* codes(int column) const;
+
+private:
+    MappedFile map_;
+    const CsvColumnCacheHeader* header_ = nullptr;
+    const uint16_t* field_counts_ = nullptr;
+    std::vector<const CsvColumnEntry*> columns_;
+
+    template <typename T>
+    const T* section(uint64_t offset) const
+    {
+        return reinterpret_cast<const T*>(map_.data() + offset);
+    }
+
+    std::string_view dict_value(const CsvColumnEntry& entry, uint32_t code) const;
+    bool sections_fit() const;
+};
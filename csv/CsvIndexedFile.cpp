@@ -1,22 +1,147 @@
 #include "CsvIndexedFile.hpp"
 
-#ifdef _WIN32
-#include <windows.h>
-#include <sys/stat.h>
-#else
-#include <sys/mman.h>
 #include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
-#endif
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <fstream>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 
 #include "../dob/DobJobApplication.hpp"
+#include "../dob/DobCsvScan.hpp"
 
 // ---------- helpers ----------
 
+namespace {
+
+// Routes each index lookup of a query to the sidecar that covers it
+class IndexSet : public query::IndexSource {
+public:
+    IndexSet(std::size_t rows, const CsvBitmapIndex* bitmaps, const CsvRangeIndex* ranges,
+             const CsvZoneMap* zones)
+        : rows_(rows), bitmaps_(bitmaps), ranges_(ranges), zones_(zones) {}
+
+    std::size_t row_count() const override { return rows_; }
+
+    std::optional<query::RowBitmap> value_rows(int column, uint32_t code) const override
+    {
+        return bitmaps_ ? bitmaps_->value_rows(column, code) : std::nullopt;
+    }
+
+    std::optional<std::size_t> range_count(int column, double lo, double hi) const override
+    {
+        return ranges_ ? ranges_->range_count(column, lo, hi) : std::nullopt;
+    }
+
+    std::optional<query::RowBitmap> range_rows(int column, double lo, double hi) const override
+    {
+        return ranges_ ? ranges_->range_rows(column, lo, hi) : std::nullopt;
+    }
+
+    std::optional<query::RowBitmap> zone_rows(int column, double lo, double hi) const override
+    {
+        return zones_ ? zones_->zone_rows(column, lo, hi) : std::nullopt;
+    }
+
+    std::optional<query::RowBitmap> zone_rows(int column, std::string_view value) const override
+    {
+        return zones_ ? zones_->zone_rows(column, value) : std::nullopt;
+    }
+
+private:
+    std::size_t rows_;
+    const CsvBitmapIndex* bitmaps_;
+    const CsvRangeIndex* ranges_;
+    const CsvZoneMap* zones_;
+};
+
+// Bytes an async_index build scans before it publishes the rows found
+constexpr uint64_t kIndexPublishBytes = 4u << 20;
+
+} // namespace
+
+// Offsets of an async_index build. They live in fixed-size segments, so
+// published offsets never move while the builder appends. Every published
+// row is followed by the offset of the next row (or the file size), so its
+// end is known too.
+struct CsvIndexedFile::IndexBuild {
+    static constexpr std::size_t kSegmentShift = 16;
+    static constexpr std::size_t kSegmentRows = std::size_t{1} << kSegmentShift;
+
+    // Sized for the worst case (a row per byte) before anything is
+    // published, and never resized
+    std::vector<std::unique_ptr<uint64_t[]>> segments;
+    std::size_t stored = 0;                 // builder thread only
+
+    std::atomic<std::size_t> rows{0};       // published rows
+    std::atomic<bool> done{false};
+    std::atomic<bool> stop{false};
+    std::exception_ptr error;               // set before done
+
+    std::mutex mutex;
+    std::condition_variable progress;
+    std::thread worker;
+
+    uint64_t offset(std::size_t i) const
+    {
+        return segments[i >> kSegmentShift][i & (kSegmentRows - 1)];
+    }
+
+    void reserve(uint64_t fileSize)
+    {
+        segments.resize(static_cast<std::size_t>((fileSize + 1) >> kSegmentShift) + 1);
+    }
+
+    void push(uint64_t value)
+    {
+        auto& segment = segments[stored >> kSegmentShift];
+        if (!segment)
+            segment = std::make_unique<uint64_t[]>(kSegmentRows);
+        segment[stored & (kSegmentRows - 1)] = value;
+        ++stored;
+    }
+
+    void publish(std::size_t count, bool finished)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rows.store(count, std::memory_order_release);
+            if (finished)
+                done.store(true, std::memory_order_release);
+        }
+        progress.notify_all();
+    }
+
+    // Published rows once there are more than n or the build is over
+    std::size_t wait_for_rows(std::size_t n)
+    {
+        std::size_t ready = rows.load(std::memory_order_acquire);
+        if (ready > n || done.load(std::memory_order_acquire))
+            return ready;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        progress.wait(lock, [&] { return rows.load(std::memory_order_relaxed) > n || done.load(std::memory_order_relaxed); });
+        return rows.load(std::memory_order_acquire);
+    }
+
+    std::size_t wait_done()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            progress.wait(lock, [&] { return done.load(std::memory_order_relaxed); });
+        }
+        if (error)
+            std::rethrow_exception(error);
+        return rows.load(std::memory_order_acquire);
+    }
+};
+
 uint64_t CsvIndexedFile::file_size(const std::string& path)
 {
 #ifdef _WIN32
@@ -34,58 +159,154 @@ uint64_t CsvIndexedFile::file_size(const std::string& path)
 
 // ---------- ctor / dtor ----------
 
-CsvIndexedFile::CsvIndexedFile(const std::string& csvPath)
+CsvIndexedFile::CsvIndexedFile(const std::string& csvPath,
+                               const CsvIndexedFileOptions& options)
     : csv_path_(csvPath),
       idx_path_(csvPath + ".idx"),
-      file_(csvPath, std::ios::binary)
+      cols_path_(csvPath + ".cols"),
+      bmp_path_(csvPath + ".bmp"),
+      rng_path_(csvPath + ".rng"),
+      zone_path_(csvPath + ".zone"),
+      options_(options),
+      file_(csvPath, std::ios::binary),
+      results_(options.result_cache_bytes)
 {
     if (!file_)
         throw std::runtime_error("Failed to open CSV");
 
+    if (options_.map_csv)
+        csv_map_.open(csv_path_);
+
     ensure_index();
+
+    const bool sidecars = options_.column_cache || options_.bitmap_indexes
+        || !options_.range_indexes.empty() || options_.zone_maps;
+    if (sidecars)
+        wait_for_index();
+
+    if (options_.column_cache || options_.bitmap_indexes || !options_.range_indexes.empty())
+        ensure_columns();
+
+    if (options_.bitmap_indexes)
+        ensure_bitmaps();
+
+    if (!options_.range_indexes.empty())
+        ensure_ranges();
+
+    if (options_.zone_maps)
+        ensure_zones();
+
+    unsigned threads = options_.query_threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (threads > 1)
+        pool_ = std::make_unique<ThreadPool>(threads - 1);
 }
 
 CsvIndexedFile::~CsvIndexedFile()
 {
-#ifdef _WIN32
-    if (mmap_mem_) {
-        UnmapViewOfFile(mmap_mem_);
-        mmap_mem_ = nullptr;
-    }
-    if (mmap_handle_) {
-        CloseHandle(static_cast<HANDLE>(mmap_handle_));
-        mmap_handle_ = nullptr;
-    }
-#else
-    if (mmap_mem_) {
-        munmap(mmap_mem_, mmap_size_);
-        mmap_mem_ = nullptr;
+    if (building_) {
+        building_->stop = true;
+        building_->worker.join();
     }
-    if (mmap_fd_ >= 0) {
-        close(mmap_fd_);
-        mmap_fd_ = -1;
-    }
-#endif
 }
 
 // ---------- public ----------
 
 std::size_t CsvIndexedFile::row_count() const
 {
+    if (building_)
+        return building_->wait_done();
+    return header_->row_count;
+}
+
+std::size_t CsvIndexedFile::indexed_rows() const
+{
+    if (building_)
+        return building_->rows.load(std::memory_order_acquire);
     return header_->row_count;
 }
 
+bool CsvIndexedFile::index_ready() const
+{
+    return !building_ || building_->done.load(std::memory_order_acquire);
+}
+
 void CsvIndexedFile::seek_row(std::size_t row_index)
 {
-    if (row_index >= header_->row_count)
+    adopt_index();
+    if (!has_row(row_index))
         throw std::out_of_range("row out of range");
 
     file_.clear();
-    file_.seekg(offsets_[row_index]);
+    file_.seekg(static_cast<std::streamoff>(row_offset(row_index)));
+}
+
+const CsvColumnCache* CsvIndexedFile::columns() const
+{
+    return columns_.is_loaded() ? &columns_ : nullptr;
+}
+
+const CsvBitmapIndex* CsvIndexedFile::bitmaps() const
+{
+    return bitmaps_.is_loaded() ? &bitmaps_ : nullptr;
+}
+
+const CsvRangeIndex* CsvIndexedFile::ranges() const
+{
+    return ranges_.is_loaded() ? &ranges_ : nullptr;
+}
+
+const CsvZoneMap* CsvIndexedFile::zones() const
+{
+    return zones_.is_loaded() ? &zones_ : nullptr;
+}
+
+std::string_view CsvIndexedFile::row_view(std::size_t row_index) const
+{
+    if (!csv_map_.is_open())
+        throw std::logic_error("row_view requires a mapped CSV");
+    if (!has_row(row_index))
+        throw std::out_of_range("row out of range");
+
+    std::size_t begin = static_cast<std::size_t>(row_offset(row_index));
+    std::size_t end = static_cast<std::size_t>(row_end(row_index));
+
+    // Offsets point just past the row terminator; drop it from the view
+    if (end > begin && csv_map_.data()[end - 1] == '\n')
+        --end;
+
+    return {csv_map_.data() + begin, end - begin};
+}
+
+uint64_t CsvIndexedFile::row_offset(std::size_t row_index) const
+{
+    return building_ ? building_->offset(row_index) : offsets_[row_index];
+}
+
+uint64_t CsvIndexedFile::row_end(std::size_t row_index) const
+{
+    if (building_)
+        return building_->offset(row_index + 1);
+
+    return row_index + 1 < header_->row_count
+        ? offsets_[row_index + 1]
+        : header_->file_size;
+}
+
+bool CsvIndexedFile::has_row(std::size_t row_index) const
+{
+    if (building_)
+        return building_->wait_for_rows(row_index) > row_index;
+    return row_index < header_->row_count;
 }
 
 std::string CsvIndexedFile::read_row(std::size_t row_index)
 {
+    adopt_index();
+    if (csv_map_.is_open())
+        return std::string(row_view(row_index));
+
     seek_row(row_index);
 
     std::string row;
@@ -126,10 +347,77 @@ void CsvIndexedFile::ensure_index()
     if (try_load_index())
         return;
 
+    if (options_.async_index) {
+        start_index_build();
+        return;
+    }
+
     build_index();
     map_index();
 }
 
+void CsvIndexedFile::ensure_columns()
+{
+    if (columns_.load(cols_path_, header_->file_size, header_->row_count))
+        return;
+
+    RowReader reader(*this);
+    CsvColumnCache::build(cols_path_, header_->file_size, row_count(),
+                          [&](std::size_t i) { return reader.row(i); });
+
+    if (!columns_.load(cols_path_, header_->file_size, header_->row_count))
+        throw std::runtime_error("Failed to load column cache");
+}
+
+void CsvIndexedFile::ensure_bitmaps()
+{
+    if (bitmaps_.load(bmp_path_, header_->file_size, header_->row_count))
+        return;
+
+    CsvBitmapIndex::build(bmp_path_, columns_, header_->file_size);
+
+    if (!bitmaps_.load(bmp_path_, header_->file_size, header_->row_count))
+        throw std::runtime_error("Failed to load bitmap index");
+}
+
+void CsvIndexedFile::ensure_ranges()
+{
+    std::vector<int> csvColumns;
+    for (const auto& name : options_.range_indexes) {
+        auto info = dob::column_info(name);
+        if (!info)
+            throw std::invalid_argument("Column name not found: " + name);
+        if (info->second != dob::ColumnCategory::NUMERIC && info->second != dob::ColumnCategory::DATE)
+            throw std::invalid_argument("Range indexes need a numeric or date column: " + name);
+        csvColumns.push_back(info->first);
+    }
+
+    if (ranges_.load(rng_path_, header_->file_size, header_->row_count, csvColumns))
+        return;
+
+    CsvRangeIndex::build(rng_path_, columns_, csvColumns, header_->file_size);
+
+    if (!ranges_.load(rng_path_, header_->file_size, header_->row_count, csvColumns))
+        throw std::runtime_error("Failed to load range index");
+}
+
+void CsvIndexedFile::ensure_zones()
+{
+    if (zones_.load(zone_path_, header_->file_size, header_->row_count))
+        return;
+
+    RowReader reader(*this);
+    auto row = [&](std::size_t i) { return reader.row(i); };
+    const bool extended = appended_
+        && CsvZoneMap::extend(zone_path_, appended_->file_size, appended_->row_count,
+                              header_->file_size, row_count(), row);
+    if (!extended)
+        CsvZoneMap::build(zone_path_, header_->file_size, row_count(), row);
+
+    if (!zones_.load(zone_path_, header_->file_size, header_->row_count))
+        throw std::runtime_error("Failed to load zone map");
+}
+
 bool CsvIndexedFile::try_load_index()
 {
 #ifdef _WIN32
@@ -143,67 +431,314 @@ bool CsvIndexedFile::try_load_index()
 #endif
 
     CsvIndexHeader h{};
-    std::ifstream in(idx_path_, std::ios::binary);
-    if (!in)
-        return false;
+    {
+        std::ifstream in(idx_path_, std::ios::binary);
+        if (!in)
+            return false;
 
-    in.read(reinterpret_cast<char*>(&h), sizeof(h));
-    if (!in)
-        return false;
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (!in)
+            return false;
+    }
+
+    const CsvIndexHeader expected{};
+    if (h.magic != expected.magic) return false;
+    if (h.version != expected.version) return false;
+
+    // A short offsets body cannot be mapped or extended; rebuild it
+    const uint64_t body = (static_cast<uint64_t>(st.st_size) - sizeof(CsvIndexHeader)) / sizeof(uint64_t);
+    if (h.row_count > body) return false;
 
-    if (h.magic != 0x4353564944583031ULL) return false;
-    if (h.version != 1) return false;
-    if (h.file_size != file_size(csv_path_)) return false;
+    const uint64_t size = file_size(csv_path_);
+    if (h.file_size != size) {
+        // An append leaves every indexed byte where it was; anything else
+        // (a rewrite, a truncation) needs a full rebuild
+        if (h.file_size > size || h.row_count == 0)
+            return false;
+
+        MappedFile scratch;
+        const MappedFile& csv = scan_mapping(scratch);
+        if (csv.size() < h.file_size || tail_fingerprint(csv.data(), h.file_size) != h.tail_hash)
+            return false;
+
+        if (!extend_index(h))
+            return false;
+    }
 
     map_index();
     return true;
 }
 
+const MappedFile& CsvIndexedFile::scan_mapping(MappedFile& scratch) const
+{
+    if (csv_map_.is_open())
+        return csv_map_;
+    scratch.open(csv_path_);
+    return scratch;
+}
+
+uint64_t CsvIndexedFile::tail_fingerprint(const char* data, uint64_t size)
+{
+    // FNV-1a, so the fingerprint does not depend on the standard library
+    const uint64_t begin = size > CsvIndexHeader::kTailBytes ? size - CsvIndexHeader::kTailBytes : 0;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (uint64_t i = begin; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+std::vector<uint64_t> CsvIndexedFile::find_row_starts(const MappedFile& csv, uint64_t begin, uint64_t end) const
+{
+    const std::size_t chunk_count = index_chunk_count(end - begin);
+
+    std::vector<ChunkScan> chunks(chunk_count);
+    auto chunk_begin = [&](std::size_t c) { return begin + (end - begin) * c / chunk_count; };
+
+    if (chunk_count == 1) {
+        scan_chunk(csv.data(), begin, end, chunks[0]);
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(chunk_count);
+        for (std::size_t c = 0; c < chunk_count; ++c) {
+            workers.emplace_back([&, c]() {
+                scan_chunk(csv.data(), chunk_begin(c), chunk_begin(c + 1), chunks[c]);
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+    }
+
+    // Fix-up pass: the quote state entering each chunk is the parity of all
+    // quotes before it, which selects the matching speculative break list
+    std::size_t total = 0;
+    bool in_quotes = false;
+    for (const auto& chunk : chunks) {
+        total += chunk.breaks[in_quotes].size();
+        in_quotes ^= chunk.quote_parity;
+    }
+
+    std::vector<uint64_t> starts;
+    starts.reserve(total);
+
+    in_quotes = false;
+    for (const auto& chunk : chunks) {
+        const auto& breaks = chunk.breaks[in_quotes];
+        starts.insert(starts.end(), breaks.begin(), breaks.end());
+        in_quotes ^= chunk.quote_parity;
+    }
+
+    // A break at the very end starts no row
+    if (!starts.empty() && starts.back() == end)
+        starts.pop_back();
+
+    return starts;
+}
+
 void CsvIndexedFile::build_index()
 {
+    // Scan a read-only mapping so chunks can be processed independently
+    MappedFile scratch;
+    const MappedFile& csv = scan_mapping(scratch);
+    const uint64_t size = csv.size();
+
+    // An empty file has no rows at all
     std::vector<uint64_t> offsets;
+    if (size > 0) {
+        offsets = find_row_starts(csv, 0, size);
+        offsets.insert(offsets.begin(), 0);
+    }
 
-    file_.clear();
-    file_.seekg(0);
+    save_index(offsets, size, tail_fingerprint(csv.data(), size));
+}
 
-    bool in_quotes = false;
-    char c;
+void CsvIndexedFile::start_index_build()
+{
+    building_ = std::make_shared<IndexBuild>();
+    building_->worker = std::thread([this, &build = *building_]() { run_index_build(build); });
+}
 
-    offsets.push_back(0);
+// Same scan and .idx layout as build_index, but a chunk at a time: each
+// chunk starts at a known row start, so the rows before the last start it
+// finds are complete and can be published while the rest is scanned
+void CsvIndexedFile::run_index_build(IndexBuild& build) const
+{
+    try {
+        MappedFile scratch;
+        const MappedFile& csv = scan_mapping(scratch);
+        const uint64_t size = csv.size();
+        build.reserve(size);
 
-    while (file_.get(c))
-    {
-        if (c == '"')
-        {
-            if (in_quotes)
-            {
-                if (file_.peek() == '"')
-                    file_.get();
-                else
-                    in_quotes = false;
-            }
-            else
-                in_quotes = true;
+        // The header is written last; until then the .idx fails to load and
+        // an interrupted build is redone on the next open
+        CsvIndexHeader pending;
+        pending.magic = 0;
+        std::ofstream out(idx_path_, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Failed to write index");
+        out.write(reinterpret_cast<const char*>(&pending), sizeof(pending));
+
+        auto store = [&](const uint64_t* starts, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i)
+                build.push(starts[i]);
+            out.write(reinterpret_cast<const char*>(starts), static_cast<std::streamsize>(n * sizeof(uint64_t)));
+        };
+
+        // An empty file has no rows at all
+        if (size > 0) {
+            const uint64_t first = 0;
+            store(&first, 1);
         }
-        else if (c == '\n' && !in_quotes)
-        {
-            offsets.push_back((uint64_t)file_.tellg());
+
+        uint64_t begin = 0;
+        uint64_t step = kIndexPublishBytes;
+        while (begin < size) {
+            if (build.stop) {
+                build.publish(build.rows.load(std::memory_order_relaxed), true);
+                return;
+            }
+
+            const uint64_t end = std::min(size, begin + step);
+            const std::vector<uint64_t> starts = find_row_starts(csv, begin, end);
+            store(starts.data(), starts.size());
+            if (end == size)
+                break;
+
+            // A single row longer than the step: widen it until the row ends
+            if (starts.empty()) {
+                step *= 2;
+                continue;
+            }
+
+            // The row at the last start may run past end, so it waits for
+            // the next chunk, which is scanned from its first byte
+            build.publish(build.stored - 1, false);
+            begin = starts.back();
+            step = kIndexPublishBytes;
         }
+
+        CsvIndexHeader h;
+        h.file_size = size;
+        h.row_count = build.stored;
+        h.tail_hash = tail_fingerprint(csv.data(), size);
+
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.close();
+        if (!out) throw std::runtime_error("Failed to write index");
+
+        // The last row ends at the end of the file
+        build.push(size);
+        build.publish(static_cast<std::size_t>(h.row_count), true);
+    } catch (...) {
+        build.error = std::current_exception();
+        build.publish(build.rows.load(std::memory_order_relaxed), true);
     }
+}
+
+void CsvIndexedFile::wait_for_index()
+{
+    if (!building_)
+        return;
+
+    building_->wait_done();
+    building_->worker.join();
+    map_index();
+    building_.reset();
+}
+
+void CsvIndexedFile::adopt_index()
+{
+    if (building_ && building_->done.load(std::memory_order_acquire))
+        wait_for_index();
+}
+
+bool CsvIndexedFile::extend_index(const CsvIndexHeader& old)
+{
+    MappedFile scratch;
+    const MappedFile& csv = scan_mapping(scratch);
+    const uint64_t size = csv.size();
+
+    // The old last row may have been unterminated and continued by the
+    // append, so the scan restarts at its first byte
+    const uint64_t last = old.row_count - 1;
+    const uint64_t last_pos = sizeof(CsvIndexHeader) + last * sizeof(uint64_t);
+
+    std::fstream io(idx_path_, std::ios::binary | std::ios::in | std::ios::out);
+    if (!io)
+        return false;
+
+    uint64_t last_start = 0;
+    io.seekg(static_cast<std::streamoff>(last_pos));
+    io.read(reinterpret_cast<char*>(&last_start), sizeof(last_start));
+    if (!io || last_start >= old.file_size)
+        return false;
+
+    const std::vector<uint64_t> starts = find_row_starts(csv, last_start, size);
+
+    // Offsets first, header last: until the header is rewritten the file
+    // still describes the old prefix
+    io.seekp(static_cast<std::streamoff>(last_pos + sizeof(uint64_t)));
+    io.write(reinterpret_cast<const char*>(starts.data()),
+             static_cast<std::streamsize>(starts.size() * sizeof(uint64_t)));
+
+    CsvIndexHeader h = old;
+    h.file_size = size;
+    h.row_count = old.row_count + starts.size();
+    h.tail_hash = tail_fingerprint(csv.data(), size);
+    io.seekp(0);
+    io.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    io.flush();
+    if (!io) throw std::runtime_error("Failed to write index");
+
+    appended_ = AppendedPrefix{old.file_size, old.row_count};
+    return true;
+}
+
+std::size_t CsvIndexedFile::index_chunk_count(uint64_t size) const
+{
+    // Chunks below this size cost more in thread start-up than they save
+    constexpr uint64_t kMinChunkBytes = 1u << 20;
+
+    std::size_t threads = options_.index_threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const uint64_t by_size = std::max<uint64_t>(1, size / kMinChunkBytes);
+    return static_cast<std::size_t>(std::min<uint64_t>(threads, by_size));
+}
+
+// A quoted '"' is written as '""', so the quote state at any byte is simply
+// the parity of the quotes before it. Each chunk is scanned once assuming it
+// starts outside quotes; newlines are filed by their local parity so the
+// fix-up pass can pick the right list once the incoming state is known.
+void CsvIndexedFile::scan_chunk(const char* data, uint64_t begin, uint64_t end,
+                                ChunkScan& out)
+{
+    const std::string_view chunk(data + begin, static_cast<std::size_t>(end - begin));
+    uint64_t in_quotes = 0;
+
+    dob::for_each_structural_block(chunk, [&](std::size_t base, const dob::StructuralMasks& m) {
+        const uint64_t quoted = dob::prefix_xor(m.quote) ^ in_quotes;
+        in_quotes = static_cast<uint64_t>(static_cast<int64_t>(quoted) >> 63);
 
-    uint64_t size = file_size(csv_path_);
-    if (!offsets.empty() && offsets.back() == size)
-        offsets.pop_back();
+        const uint64_t at = begin + base + 1;
+        for (uint64_t bits = m.newline & ~quoted; bits != 0; bits &= bits - 1)
+            out.breaks[0].push_back(at + static_cast<uint64_t>(dob::lowest_bit(bits)));
+        for (uint64_t bits = m.newline & quoted; bits != 0; bits &= bits - 1)
+            out.breaks[1].push_back(at + static_cast<uint64_t>(dob::lowest_bit(bits)));
+    });
 
-    save_index(offsets, size);
+    out.quote_parity = in_quotes != 0;
 }
 
 void CsvIndexedFile::save_index(const std::vector<uint64_t>& offsets,
-                                uint64_t fileSize)
+                                uint64_t fileSize, uint64_t tailHash)
 {
     CsvIndexHeader h;
     h.file_size = fileSize;
     h.row_count = offsets.size();
+    h.tail_hash = tailHash;
 
     std::ofstream out(idx_path_, std::ios::binary);
     if (!out) throw std::runtime_error("Failed to write index");
@@ -215,79 +750,661 @@ void CsvIndexedFile::save_index(const std::vector<uint64_t>& offsets,
 
 void CsvIndexedFile::map_index()
 {
-#ifdef _WIN32
-    HANDLE file = CreateFileA(
-        idx_path_.c_str(),
-        GENERIC_READ,
-        FILE_SHARE_READ,
-        nullptr,
-        OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL,
-        nullptr);
+    index_map_.open(idx_path_);
+
+    if (index_map_.size() < sizeof(CsvIndexHeader))
+        throw std::runtime_error("index file truncated");
 
-    if (file == INVALID_HANDLE_VALUE) {
-        throw std::runtime_error("open idx failed");
+    header_ = reinterpret_cast<const CsvIndexHeader*>(index_map_.data());
+    offsets_ = reinterpret_cast<const uint64_t*>(
+        index_map_.data() + sizeof(CsvIndexHeader));
+}
+
+// ---------- row reader ----------
+
+CsvIndexedFile::RowReader::RowReader(const CsvIndexedFile& file)
+    : file_(file)
+{
+    if (!file_.csv_map_.is_open()) {
+        in_.open(file_.csv_path_, std::ios::binary);
+        if (!in_)
+            throw std::runtime_error("Failed to open CSV");
     }
+}
+
+std::string_view CsvIndexedFile::RowReader::row(std::size_t row_index)
+{
+    if (file_.csv_map_.is_open())
+        return file_.row_view(row_index);
+
+    if (row_index == last_row_)
+        return last_view_;
+
+    if (!file_.has_row(row_index))
+        throw std::out_of_range("row out of range");
+
+    // The index already knows where the row ends, so read it in one call
+    const uint64_t begin = file_.row_offset(row_index);
+    const uint64_t end = file_.row_end(row_index);
+    buffer_.resize(static_cast<std::size_t>(end - begin));
+
+    in_.clear();
+    in_.seekg(static_cast<std::streamoff>(begin));
+    in_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.resize(static_cast<std::size_t>(in_.gcount()));
+
+    std::string_view row(buffer_);
+    if (!row.empty() && row.back() == '\n')
+        row.remove_suffix(1);
+
+    last_row_ = row_index;
+    last_view_ = row;
+    return row;
+}
+
+// ---------- query ----------
+
+std::size_t CsvIndexedFile::query_shard_count(std::size_t count) const
+{
+    // Oversplit so uneven shards still balance across the workers
+    constexpr std::size_t kShardsPerThread = 4;
+    constexpr std::size_t kMinShardRows = 4096;
 
-    LARGE_INTEGER size{};
-    if (!GetFileSizeEx(file, &size)) {
-        CloseHandle(file);
-        throw std::runtime_error("GetFileSizeEx failed");
+    // A scan that follows a background index build has no fixed row count
+    // to split, so it runs as one shard
+    if (!pool_ || building_)
+        return 1;
+
+    const std::size_t by_rows = std::max<std::size_t>(1, count / kMinShardRows);
+    return std::min(pool_->concurrency() * kShardsPerThread, by_rows);
+}
+
+void CsvIndexedFile::for_each_shard(
+    std::size_t shards, std::size_t count,
+    const std::function<void(std::size_t, std::size_t, std::size_t)>& fn)
+{
+    auto shard_begin = [&](std::size_t s) { return count * s / shards; };
+
+    auto task = [&](std::size_t s) { fn(s, shard_begin(s), shard_begin(s + 1)); };
+
+    if (pool_)
+        pool_->parallel_for(shards, task);
+    else
+        for (std::size_t s = 0; s < shards; ++s)
+            task(s);
+}
+
+CsvIndexedFile::ScanPlan CsvIndexedFile::plan_scan(query::Query& q)
+{
+    adopt_index();
+    q.bind(columns());
+
+    ScanPlan plan;
+    if (building_) {
+        plan.following = true;
+        plan.build = building_;
+        plan.count = std::numeric_limits<std::size_t>::max();
+        last_query_stats_ = CsvQueryStats{0, plan.count, 0};
+        return plan;
     }
 
-    mmap_size_ = static_cast<size_t>(size.QuadPart);
+    // A repeated query visits just the rows it matched last time, unless
+    // the CSV no longer has the size the index was built for
+    if (results_.enabled()) {
+        std::string key = q.canonical();
+        if (!key.empty() && file_size(csv_path_) == header_->file_size) {
+            const uint64_t fingerprint = q.fingerprint();
+            if (const query::RowBitmap* cached = results_.find(key, fingerprint, header_->file_size, row_count())) {
+                plan.narrowed = true;
+                plan.exact = true;
+                plan.rows = cached->to_vector();
+                plan.candidates = *cached;
+            } else {
+                plan.recording = std::make_unique<ScanPlan::Recording>();
+                plan.recording->key = std::move(key);
+                plan.recording->fingerprint = fingerprint;
+            }
+        } else if (!key.empty()) {
+            results_.invalidate();
+        }
+    }
 
-    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
-    CloseHandle(file);
+    // The secondary indexes may narrow the scan to a candidate set; when that
+    // set is exact the predicate does not need to be evaluated at all
+    if (!plan.narrowed && (bitmaps_.is_loaded() || ranges_.is_loaded() || zones_.is_loaded())) {
+        auto candidates = q.candidates(IndexSet(row_count(), bitmaps(), ranges(), zones()));
 
-    if (!mapping) {
-        throw std::runtime_error("CreateFileMapping failed");
+        // A nearly full inexact set is cheaper to scan straight through
+        constexpr double kMaxInexactFraction = 0.9;
+        if (candidates && !candidates->exact
+            && static_cast<double>(candidates->rows.cardinality())
+                > kMaxInexactFraction * static_cast<double>(row_count()))
+            candidates.reset();
+
+        if (candidates) {
+            // An exact set is as cheap as a cached one
+            if (candidates->exact)
+                plan.recording.reset();
+            plan.narrowed = true;
+            plan.exact = candidates->exact;
+            plan.rows = candidates->rows.to_vector();
+            plan.candidates = std::move(candidates->rows);
+        }
     }
 
-    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
-    if (!view) {
-        CloseHandle(mapping);
-        throw std::runtime_error("MapViewOfFile failed");
+    plan.count = plan.narrowed ? plan.rows.size() : row_count();
+    last_query_stats_ = CsvQueryStats{row_count(), plan.count, 0};
+    return plan;
+}
+
+void CsvIndexedFile::finish_scan(const ScanPlan& plan, std::size_t matched)
+{
+    if (plan.following) {
+        // A scan that stopped early may have left the build running
+        auto& stats = last_query_stats_;
+        stats.rows = plan.build->rows.load(std::memory_order_acquire);
+        stats.rows_scanned = std::min(stats.rows_scanned, stats.rows);
+        if (plan.build->done.load(std::memory_order_acquire) && plan.build->error)
+            std::rethrow_exception(plan.build->error);
     }
+    last_query_stats_.rows_matched = matched;
 
-    mmap_handle_ = mapping;
-    mmap_mem_ = view;
-#else
-    mmap_fd_ = open(idx_path_.c_str(), O_RDONLY);
-    if (mmap_fd_ < 0)
-        throw std::runtime_error("open idx failed");
+    if (plan.recording && last_query_stats_.rows_scanned == plan.count) {
+        auto& pieces = plan.recording->pieces;
+        std::sort(pieces.begin(), pieces.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
 
-    struct stat st{};
-    fstat(mmap_fd_, &st);
+        query::RowBitmap rows;
+        for (const auto& piece : pieces)
+            for (uint32_t i : piece.second)
+                rows.add(i);
+        results_.insert(plan.recording->key, plan.recording->fingerprint, std::move(rows));
+    }
+}
 
-    mmap_size_ = st.st_size;
+std::size_t CsvIndexedFile::scan(query::Query& q, const ScanPlan& plan,
+                                 std::size_t begin, std::size_t end,
+                                 const MatchFn& on_match) const
+{
+    RowReader reader(*this);
 
-    mmap_mem_ = mmap(nullptr, mmap_size_, PROT_READ, MAP_SHARED, mmap_fd_, 0);
+    if (plan.recording) {
+        std::vector<uint32_t> matches;
+        const std::size_t visited = scan_range(q, plan, begin, end, reader, [&](std::size_t i, RowReader& r) {
+            matches.push_back(static_cast<uint32_t>(i));
+            return on_match(i, r);
+        });
 
-    if (mmap_mem_ == MAP_FAILED)
-        throw std::runtime_error("mmap failed");
-#endif
+        std::lock_guard<std::mutex> lock(plan.recording->mutex);
+        plan.recording->pieces.emplace_back(begin, std::move(matches));
+        return visited;
+    }
 
-    header_ = reinterpret_cast<CsvIndexHeader*>(mmap_mem_);
-    offsets_ = reinterpret_cast<uint64_t*>(
-        reinterpret_cast<char*>(mmap_mem_) + sizeof(CsvIndexHeader));
+    if (!plan.following)
+        return scan_range(q, plan, begin, end, reader, on_match);
+
+    // Scan the rows indexed so far, then wait for the build to publish more
+    std::size_t next = begin;
+    for (;;) {
+        const std::size_t ready = std::min(end, plan.build->wait_for_rows(next));
+        if (ready <= next)
+            return next - begin;
+
+        const std::size_t visited = scan_range(q, plan, next, ready, reader, on_match);
+        if (visited < ready - next)
+            return next + visited - begin;
+        next = ready;
+    }
+}
+
+std::size_t CsvIndexedFile::scan_range(query::Query& q, const ScanPlan& plan,
+                                       std::size_t begin, std::size_t end,
+                                       RowReader& reader, const MatchFn& on_match) const
+{
+    // With the column cache, predicates read only the typed columns
+    // they reference and the CSV is touched just for matching rows
+    if (columns_.is_loaded()) {
+        // A full scan goes block by block: the predicate fills a selection
+        // mask from the column arrays and only its set bits are visited
+        if (options_.batch_eval && !plan.narrowed) {
+            query::BatchMask mask;
+            for (std::size_t block = begin; block < end; block += query::kBatchRows)
+            {
+                const std::size_t count = std::min(query::kBatchRows, end - block);
+                q.eval_batch(columns_, block, count, mask);
+                for (std::size_t w = 0; w < query::mask_words(count); ++w)
+                {
+                    for (uint64_t bits = mask[w]; bits != 0; bits &= bits - 1)
+                    {
+                        const std::size_t i = block + w * 64 + static_cast<std::size_t>(dob::lowest_bit(bits));
+                        if (!on_match(i, reader))
+                            return i + 1 - begin;
+                    }
+                }
+            }
+            return end - begin;
+        }
+
+        query::RowContext context(columns_);
+        for (std::size_t p = begin; p < end; ++p)
+        {
+            const std::size_t i = plan.row_at(p);
+            context.reset(i);
+            if ((plan.exact || q.eval(context)) && !on_match(i, reader))
+                return p + 1 - begin;
+        }
+        return end - begin;
+    }
+
+    query::RowContext context(q.max_column());
+    for (std::size_t p = begin; p < end; ++p)
+    {
+        const std::size_t i = plan.row_at(p);
+        context.reset(reader.row(i));
+        if ((plan.exact || q.eval(context)) && !on_match(i, reader))
+            return p + 1 - begin;
+    }
+    return end - begin;
 }
 
 std::vector<dob::DobJobApplication> CsvIndexedFile::query(query::Query &q) {
+    const ScanPlan plan = plan_scan(q);
+
+    const std::size_t shards = query_shard_count(plan.count);
+    std::vector<std::vector<dob::DobJobApplication>> partial(shards);
+
+    for_each_shard(shards, plan.count, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+        auto& results = partial[shard];
+        scan(q, plan, begin, end, [&](std::size_t i, RowReader& reader) {
+            results.push_back(dob::parse_row(reader.row(i)));
+            return true;
+        });
+    });
+
+    std::size_t total = 0;
+    for (const auto& p : partial)
+        total += p.size();
+    finish_scan(plan, total);
+
+    if (shards == 1)
+        return std::move(partial.front());
+
     std::vector<dob::DobJobApplication> results;
+    results.reserve(total);
+    for (auto& p : partial)
+        results.insert(results.end(),
+                       std::make_move_iterator(p.begin()),
+                       std::make_move_iterator(p.end()));
 
-    for (std::size_t i = 0; i < row_count(); ++i)
-    {
-        std::string row = read_row(i);
-        if (q.eval(row))
-        {
-            try {
-                results.push_back(dob::parse_row(row));
-            } catch (const std::exception& e) {
-                // Handle parse error (e.g., log it)
+    return results;
+}
+
+std::vector<dob::DobJobApplication> CsvIndexedFile::query(query::Query &q, std::size_t limit) {
+    std::vector<dob::DobJobApplication> results;
+    for_each(q, [&](const dob::DobJobApplication& app) {
+        results.push_back(app);
+        return true;
+    }, limit);
+    return results;
+}
+
+std::size_t CsvIndexedFile::for_each(query::Query& q,
+                                     const std::function<bool(const dob::DobJobApplication&)>& fn,
+                                     std::size_t limit)
+{
+    const ScanPlan plan = plan_scan(q);
+
+    std::size_t delivered = 0;
+    if (limit > 0) {
+        last_query_stats_.rows_scanned = scan(q, plan, 0, plan.count, [&](std::size_t i, RowReader& reader) {
+            const dob::DobJobApplication app = dob::parse_row(reader.row(i));
+            ++delivered;
+            return fn(app) && delivered < limit;
+        });
+    } else {
+        last_query_stats_.rows_scanned = 0;
+    }
+
+    finish_scan(plan, delivered);
+    return delivered;
+}
+
+dob::DobJobApplicationViews CsvIndexedFile::query_views(query::Query& q)
+{
+    const ScanPlan plan = plan_scan(q);
+    const bool stable = is_mapped();
+
+    const std::size_t shards = query_shard_count(plan.count);
+    std::vector<dob::DobJobApplicationViews> partial(shards);
+
+    for_each_shard(shards, plan.count, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+        auto& results = partial[shard];
+        scan(q, plan, begin, end, [&](std::size_t i, RowReader& reader) {
+            results.append(reader.row(i), stable);
+            return true;
+        });
+    });
+
+    dob::DobJobApplicationViews results = std::move(partial.front());
+    for (std::size_t s = 1; s < shards; ++s)
+        results.append(std::move(partial[s]));
+
+    finish_scan(plan, results.size());
+    return results;
+}
+
+dob::DobJobApplicationBatch CsvIndexedFile::query_batch(query::Query& q)
+{
+    const ScanPlan plan = plan_scan(q);
+
+    const std::size_t shards = query_shard_count(plan.count);
+    std::vector<dob::DobJobApplicationBatch> partial(shards);
+
+    for_each_shard(shards, plan.count, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+        auto& results = partial[shard];
+        dob::Arena scratch;     // unescaped text, until it is copied into the batch
+        scan(q, plan, begin, end, [&](std::size_t i, RowReader& reader) {
+            results.push_back(dob::parse_row_view(reader.row(i), scratch));
+            scratch.reset();
+            return true;
+        });
+    });
+
+    dob::DobJobApplicationBatch results = std::move(partial.front());
+    for (std::size_t s = 1; s < shards; ++s)
+        results.append(std::move(partial[s]));
+
+    finish_scan(plan, results.size());
+    return results;
+}
+
+query::RowContext CsvIndexedFile::field_context(int maxColumn) const
+{
+    if (columns_.is_loaded())
+        return query::RowContext(columns_);
+    return query::RowContext(maxColumn);
+}
+
+void CsvIndexedFile::load_fields(query::RowContext& context, int maxColumn,
+                                 std::size_t row, RowReader& reader) const
+{
+    if (context.source())
+        context.reset(row);
+    else
+        context.reset(reader.row(row), maxColumn);
+}
+
+void CsvIndexedFile::project(query::RowContext& context, const query::Projection& projection,
+                             std::size_t row, RowReader& reader, query::ProjectedRow& out) const
+{
+    load_fields(context, projection.max_column(), row, reader);
+    out.row = row;
+    projection.fill(context, out);
+}
+
+std::vector<query::ProjectedRow> CsvIndexedFile::query(query::Query& q, const query::Projection& projection)
+{
+    const ScanPlan plan = plan_scan(q);
+
+    const std::size_t shards = query_shard_count(plan.count);
+    std::vector<std::vector<query::ProjectedRow>> partial(shards);
+
+    for_each_shard(shards, plan.count, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+        auto& results = partial[shard];
+        query::RowContext context = field_context(projection.max_column());
+        scan(q, plan, begin, end, [&](std::size_t i, RowReader& reader) {
+            project(context, projection, i, reader, results.emplace_back());
+            return true;
+        });
+    });
+
+    std::size_t total = 0;
+    for (const auto& p : partial)
+        total += p.size();
+    finish_scan(plan, total);
+
+    if (shards == 1)
+        return std::move(partial.front());
+
+    std::vector<query::ProjectedRow> results;
+    results.reserve(total);
+    for (auto& p : partial)
+        results.insert(results.end(),
+                       std::make_move_iterator(p.begin()),
+                       std::make_move_iterator(p.end()));
+
+    return results;
+}
+
+std::size_t CsvIndexedFile::for_each(query::Query& q, const query::Projection& projection,
+                                     const std::function<bool(const query::ProjectedRow&)>& fn,
+                                     std::size_t limit)
+{
+    const ScanPlan plan = plan_scan(q);
+
+    std::size_t delivered = 0;
+    if (limit > 0) {
+        query::RowContext context = field_context(projection.max_column());
+        query::ProjectedRow row;
+        last_query_stats_.rows_scanned = scan(q, plan, 0, plan.count, [&](std::size_t i, RowReader& reader) {
+            project(context, projection, i, reader, row);
+            ++delivered;
+            return fn(row) && delivered < limit;
+        });
+    } else {
+        last_query_stats_.rows_scanned = 0;
+    }
+
+    finish_scan(plan, delivered);
+    return delivered;
+}
+
+std::vector<query::GroupRow> CsvIndexedFile::aggregate(query::Query& q, const query::GroupBy& groupBy)
+{
+    const ScanPlan plan = plan_scan(q);
+
+    const std::size_t shards = query_shard_count(plan.count);
+    std::vector<query::GroupTable> partial;
+    partial.reserve(shards);
+    for (std::size_t s = 0; s < shards; ++s)
+        partial.emplace_back(groupBy, columns());
+    std::vector<std::size_t> matched(shards, 0);
+
+    for_each_shard(shards, plan.count, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+        auto& table = partial[shard];
+        query::RowContext context = field_context(groupBy.max_column());
+        scan(q, plan, begin, end, [&](std::size_t i, RowReader& reader) {
+            load_fields(context, groupBy.max_column(), i, reader);
+            table.add(context);
+            ++matched[shard];
+            return true;
+        });
+    });
+
+    query::GroupTable& groups = partial.front();
+    for (std::size_t s = 1; s < shards; ++s)
+        groups.merge(std::move(partial[s]));
+
+    std::size_t total = 0;
+    for (std::size_t n : matched)
+        total += n;
+    finish_scan(plan, total);
+    return groups.rows();
+}
+
+std::vector<std::vector<dob::DobJobApplication>> CsvIndexedFile::query_many(std::span<query::Query* const> queries)
+{
+    wait_for_index();
+
+    const std::size_t n = queries.size();
+    int maxColumn = -1;
+    for (query::Query* q : queries) {
+        q->bind(columns());
+        maxColumn = std::max(maxColumn, q->max_column());
+    }
+
+    // Leaves with the same canonical form in more than one place share a
+    // result slot: of the row context, or of the block's SharedMasks
+    std::vector<query::Query*> leaves;
+    for (query::Query* q : queries)
+        q->leaves(leaves);
+
+    std::unordered_map<std::string, std::vector<query::Query*>> forms;
+    for (query::Query* leaf : leaves) {
+        std::string form = leaf->canonical();
+        if (!form.empty())
+            forms[std::move(form)].push_back(leaf);
+    }
+
+    int slots = 0;
+    for (auto& entry : forms) {
+        if (entry.second.size() < 2)
+            continue;
+        for (query::Query* leaf : entry.second)
+            leaf->share_as(slots);
+        ++slots;
+    }
+
+    // The slots only mean something to this scan's contexts
+    struct Unshare {
+        const std::vector<query::Query*>& leaves;
+        ~Unshare() { for (query::Query* leaf : leaves) leaf->share_as(-1); }
+    } unshare{leaves};
+
+    const std::size_t rows = row_count();
+    last_query_stats_ = CsvQueryStats{rows, rows, 0};
+
+    const std::size_t shards = query_shard_count(rows);
+    std::vector<std::vector<std::vector<dob::DobJobApplication>>> partial(
+        shards, std::vector<std::vector<dob::DobJobApplication>>(n));
+
+    for_each_shard(shards, rows, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+        auto& results = partial[shard];
+        RowReader reader(*this);
+
+        // Parse row i once for every query that matched it
+        std::vector<std::size_t> matched;
+        auto deliver = [&](std::size_t i) {
+            dob::DobJobApplication app = dob::parse_row(reader.row(i));
+            for (std::size_t k = 0; k + 1 < matched.size(); ++k)
+                results[matched[k]].push_back(app);
+            results[matched.back()].push_back(std::move(app));
+            matched.clear();
+        };
+
+        if (columns_.is_loaded() && options_.batch_eval) {
+            std::vector<query::BatchMask> masks(n);
+            query::SharedMasks shared(static_cast<std::size_t>(slots));
+            for (std::size_t block = begin; block < end; block += query::kBatchRows)
+            {
+                const std::size_t count = std::min(query::kBatchRows, end - block);
+                query::BatchMask any{};
+                shared.reset();
+                for (std::size_t k = 0; k < n; ++k)
+                {
+                    queries[k]->eval_batch(columns_, block, count, masks[k], &shared);
+                    for (std::size_t w = 0; w < query::mask_words(count); ++w)
+                        any[w] |= masks[k][w];
+                }
+
+                for (std::size_t w = 0; w < query::mask_words(count); ++w)
+                {
+                    for (uint64_t bits = any[w]; bits != 0; bits &= bits - 1)
+                    {
+                        const uint64_t bit = bits & (~bits + 1);
+                        for (std::size_t k = 0; k < n; ++k)
+                            if (masks[k][w] & bit)
+                                matched.push_back(k);
+                        deliver(block + w * 64 + static_cast<std::size_t>(dob::lowest_bit(bits)));
+                    }
+                }
             }
+            return;
         }
-    }
 
+        query::RowContext context = field_context(maxColumn);
+        context.share_slots(static_cast<std::size_t>(slots));
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            load_fields(context, maxColumn, i, reader);
+            for (std::size_t k = 0; k < n; ++k)
+                if (queries[k]->eval(context))
+                    matched.push_back(k);
+            if (!matched.empty())
+                deliver(i);
+        }
+    });
+
+    std::vector<std::vector<dob::DobJobApplication>> results = std::move(partial.front());
+    for (std::size_t s = 1; s < shards; ++s)
+        for (std::size_t k = 0; k < n; ++k)
+            results[k].insert(results[k].end(),
+                              std::make_move_iterator(partial[s][k].begin()),
+                              std::make_move_iterator(partial[s][k].end()));
+
+    std::size_t total = 0;
+    for (const auto& r : results)
+        total += r.size();
+    last_query_stats_.rows_matched = total;
     return results;
 }
+
+std::size_t CsvIndexedFile::count(query::Query& q)
+{
+    const ScanPlan plan = plan_scan(q);
+
+    std::size_t total = 0;
+    if (plan.exact) {
+        total = plan.count;
+        last_query_stats_.rows_scanned = 0;
+    } else {
+        const std::size_t shards = query_shard_count(plan.count);
+        std::vector<std::size_t> partial(shards, 0);
+
+        for_each_shard(shards, plan.count, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+            scan(q, plan, begin, end, [&](std::size_t, RowReader&) {
+                ++partial[shard];
+                return true;
+            });
+        });
+
+        for (std::size_t n : partial)
+            total += n;
+    }
+
+    finish_scan(plan, total);
+    return total;
+}
+
+query::RowBitmap CsvIndexedFile::match_rows(query::Query& q)
+{
+    ScanPlan plan = plan_scan(q);
+
+    if (plan.exact) {
+        last_query_stats_.rows_scanned = 0;
+        last_query_stats_.rows_matched = plan.count;
+        return std::move(plan.candidates);
+    }
+
+    const std::size_t shards = query_shard_count(plan.count);
+    std::vector<std::vector<uint32_t>> partial(shards);
+
+    for_each_shard(shards, plan.count, [&](std::size_t shard, std::size_t begin, std::size_t end) {
+        scan(q, plan, begin, end, [&](std::size_t i, RowReader&) {
+            partial[shard].push_back(static_cast<uint32_t>(i));
+            return true;
+        });
+    });
+
+    // Shards cover increasing row ranges, so the ids arrive in order
+    query::RowBitmap rows;
+    std::size_t total = 0;
+    for (const auto& p : partial) {
+        for (uint32_t i : p)
+            rows.add(i);
+        total += p.size();
+    }
+
+    finish_scan(plan, total);
+    return rows;
+}
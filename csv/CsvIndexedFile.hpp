@@ -1,54 +1,365 @@
 #pragma once
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
+#include "CsvBitmapIndex.hpp"
+#include "CsvColumnCache.hpp"
+#include "CsvRangeIndex.hpp"
+#include "CsvResultCache.hpp"
+#include "CsvZoneMap.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
 #include "../dob/DobJobApplication.hpp"
+#include "../dob/DobJobApplicationBatch.hpp"
+#include "../dob/DobJobApplicationView.hpp"
+#include "../query/Aggregation.hpp"
+#include "../query/Projection.hpp"
 #include "../query/Querys.hpp"
 
 struct CsvIndexHeader {
     uint64_t magic = 0x4353564944583031ULL; // CSVIDX01
-    uint64_t version = 1;
+    uint64_t version = 2;
     uint64_t file_size = 0;
     uint64_t row_count = 0;
+
+    // Fingerprint of the last kTailBytes bytes the index covers: when the
+    // CSV has grown and still holds these bytes at the same place, it was
+    // appended to and the index is extended instead of rebuilt
+    uint64_t tail_hash = 0;
+
+    static constexpr uint64_t kTailBytes = 4096;
+};
+
+struct CsvIndexedFileOptions {
+    // Map the CSV itself and serve rows as views into the mapping
+    bool map_csv = false;
+
+    // Worker threads used when the index has to be built (0 = one per core)
+    unsigned index_threads = 1;
+
+    // Build a missing or stale index on a background thread instead of in
+    // the constructor. Rows are published a chunk at a time: queries issued
+    // meanwhile scan the indexed prefix on the calling thread and then
+    // follow the build forward, and row_count() waits for it to finish.
+    // The column cache and the other sidecars need the whole index, so
+    // asking for any of them still waits in the constructor.
+    bool async_index = false;
+
+    // Worker threads used to evaluate queries (0 = one per core)
+    unsigned query_threads = 1;
+
+    // Keep a typed columnar copy of every COLUMN_SCHEMA column in a
+    // <csv>.cols sidecar and evaluate predicates against it
+    bool column_cache = false;
+
+    // Evaluate predicates against the column cache a block of rows at a
+    // time (query::Query::eval_batch) instead of row by row
+    bool batch_eval = true;
+
+    // Keep per-value row bitmaps of the low-cardinality cached columns in a
+    // <csv>.bmp sidecar and use them to skip rows that cannot match.
+    // Implies column_cache.
+    bool bitmap_indexes = false;
+
+    // Numeric or date columns (by name) to keep sorted (value, row) lists
+    // for in a <csv>.rng sidecar, so selective ranges on them skip the scan.
+    // Implies column_cache.
+    std::vector<std::string> range_indexes;
+
+    // Keep per-block min/max and value filters of every column in a
+    // <csv>.zone sidecar and skip blocks that cannot match
+    bool zone_maps = false;
+
+    // Memory for the matching row ids of recent queries (0 = no cache).
+    // A query whose Query::canonical() form was seen before only visits
+    // the cached rows; the cache is dropped when the CSV's size no longer
+    // matches the index.
+    std::size_t result_cache_bytes = 0;
+};
+
+// What the last query() did
+struct CsvQueryStats {
+    std::size_t rows = 0;           // rows in the file
+    std::size_t rows_scanned = 0;   // rows read or evaluated after index/zone pruning
+    std::size_t rows_matched = 0;
+
+    double skip_rate() const
+    {
+        return rows ? 1.0 - static_cast<double>(rows_scanned) / static_cast<double>(rows) : 0.0;
+    }
 };
 
 class CsvIndexedFile {
 public:
-    explicit CsvIndexedFile(const std::string& csvPath);
+    explicit CsvIndexedFile(const std::string& csvPath,
+                            const CsvIndexedFileOptions& options = {});
     ~CsvIndexedFile();
 
+    // Waits for a background index build to finish
     std::size_t row_count() const;
 
+    // Rows indexed so far; row_count() once the index is complete
+    std::size_t indexed_rows() const;
+    bool index_ready() const;
+
+    // Block until a background index build has finished (rethrowing its
+    // error, if any) and switch to the .idx it wrote
+    void wait_for_index();
+
     void seek_row(std::size_t row_index);
     std::string read_row(std::size_t row_index);
+
+    // Zero-copy view of a row (without its trailing newline); requires map_csv.
+    // The view stays valid for the lifetime of this object.
+    std::string_view row_view(std::size_t row_index) const;
+    bool is_mapped() const { return csv_map_.is_open(); }
+
+    // The columnar cache, or nullptr when column_cache is off
+    const CsvColumnCache* columns() const;
+
+    // The bitmap indexes, or nullptr when bitmap_indexes is off
+    const CsvBitmapIndex* bitmaps() const;
+
+    // The range indexes, or nullptr when range_indexes is empty
+    const CsvRangeIndex* ranges() const;
+
+    // The zone maps, or nullptr when zone_maps is off
+    const CsvZoneMap* zones() const;
+
     std::vector<dob::DobJobApplication> query(query::Query &q);
 
+    // The first limit matches, in row order
+    std::vector<dob::DobJobApplication> query(query::Query &q, std::size_t limit);
+
+    // Stream matches to fn one at a time, in row order, on the calling
+    // thread; only one parsed row is alive at a time. Stops after limit
+    // matches or as soon as fn returns false. Returns the matches delivered.
+    std::size_t for_each(query::Query& q,
+                         const std::function<bool(const dob::DobJobApplication&)>& fn,
+                         std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+    // Matches as records whose text fields are views: into the mapped CSV
+    // when map_csv is on (valid for the lifetime of this object), otherwise
+    // into the returned batch's arena. No per-field allocations.
+    dob::DobJobApplicationViews query_views(query::Query& q);
+
+    // Matches in struct-of-arrays form, parsed straight into the batch's
+    // columns and text heap
+    dob::DobJobApplicationBatch query_batch(query::Query& q);
+
+    // Only the projected columns of each match, in row order. Rows are
+    // split no further than the highest projected column; with the column
+    // cache the values come from the typed columns and the CSV is not read.
+    std::vector<query::ProjectedRow> query(query::Query& q, const query::Projection& projection);
+
+    // Stream projected matches like for_each above; the row passed to fn is
+    // reused for the next match
+    std::size_t for_each(query::Query& q, const query::Projection& projection,
+                         const std::function<bool(const query::ProjectedRow&)>& fn,
+                         std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+    // Grouped aggregates over the matches, fused with the scan: each query
+    // thread folds its matches into its own hash table, read through the
+    // column cache when it is loaded, and the tables are merged at the end.
+    // No row is parsed into a record. Groups come back sorted by key.
+    std::vector<query::GroupRow> aggregate(query::Query& q, const query::GroupBy& groupBy);
+
+    // Matches of several queries from one pass over the file: results[k]
+    // holds those of queries[k], in row order. Each row is read and split
+    // once for all of them, a leaf predicate several queries share (same
+    // Query::canonical() form) is evaluated once per row (once per block
+    // of rows with the column cache and batch_eval), and a row that
+    // more than one query matches is parsed once. Waits for a background
+    // index build; the secondary indexes and the result cache are not
+    // consulted.
+    std::vector<std::vector<dob::DobJobApplication>> query_many(std::span<query::Query* const> queries);
+
+    // Number of matches, without parsing any row. Queries the indexes
+    // answer exactly are counted without touching a row at all.
+    std::size_t count(query::Query& q);
+
+    // Indices of the matching rows, without parsing any row
+    query::RowBitmap match_rows(query::Query& q);
+
+    const CsvQueryStats& last_query_stats() const { return last_query_stats_; }
+
+    // Hit / miss counters and size of the result cache
+    const CsvResultCacheStats& result_cache_stats() const { return results_.stats(); }
+    void clear_result_cache() { results_.clear(); }
+
+    // Independent read path over the rows of a CsvIndexedFile. Each worker
+    // of a parallel scan owns one, so scans never share file_'s position.
+    class RowReader {
+    public:
+        explicit RowReader(const CsvIndexedFile& file);
+
+        // View of the row without its terminator; valid until the next call
+        // for a different row
+        std::string_view row(std::size_t row_index);
+
+    private:
+        const CsvIndexedFile& file_;
+        std::ifstream in_;
+        std::string buffer_;
+
+        std::size_t last_row_ = std::numeric_limits<std::size_t>::max();
+        std::string_view last_view_;
+    };
+
 private:
     std::string csv_path_;
     std::string idx_path_;
+    std::string cols_path_;
+    std::string bmp_path_;
+    std::string rng_path_;
+    std::string zone_path_;
+
+    CsvIndexedFileOptions options_;
 
     std::ifstream file_;
 
-    // mmap index
-#ifdef _WIN32
-    void* mmap_mem_ = nullptr;
-    void* mmap_handle_ = nullptr;
-#else
-    int mmap_fd_ = -1;
-    void* mmap_mem_ = nullptr;
-#endif
-    size_t mmap_size_ = 0;
+    MappedFile index_map_;
+    MappedFile csv_map_;
+
+    const CsvIndexHeader* header_ = nullptr;
+    const uint64_t* offsets_ = nullptr;
+
+    // Offsets published by an async_index build; rows are read through it
+    // until the .idx it writes is mapped
+    struct IndexBuild;
+    std::shared_ptr<IndexBuild> building_;
 
-    CsvIndexHeader* header_ = nullptr;
-    uint64_t* offsets_ = nullptr;
+    // Size and row count of the CSV before an append, when the index was
+    // extended on open; sidecars built for that prefix can be extended too
+    struct AppendedPrefix {
+        uint64_t file_size = 0;
+        uint64_t row_count = 0;
+    };
+    std::optional<AppendedPrefix> appended_;
+
+    CsvColumnCache columns_;
+    CsvBitmapIndex bitmaps_;
+    CsvRangeIndex ranges_;
+    CsvZoneMap zones_;
+
+    CsvQueryStats last_query_stats_;
+    CsvResultCache results_;
+
+    std::unique_ptr<ThreadPool> pool_;
 
 private:
+    // Row breaks found in one chunk of the CSV, speculatively recorded for
+    // both possible quote states at the chunk start
+    struct ChunkScan {
+        std::vector<uint64_t> breaks[2];
+        bool quote_parity = false;
+    };
+
     void ensure_index();
+    void ensure_columns();
+    void ensure_bitmaps();
+    void ensure_ranges();
+    void ensure_zones();
     bool try_load_index();
     void build_index();
-    void save_index(const std::vector<uint64_t>& offsets, uint64_t fileSize);
+
+    // Start the async_index build, and map the .idx it wrote once it is
+    // done; adopt_index never waits
+    void start_index_build();
+    void run_index_build(IndexBuild& build) const;
+    void adopt_index();
+
+    // Extend an index built for a prefix of the CSV: only the bytes from
+    // the start of its last row on are scanned, and the new offsets are
+    // written over the tail of the .idx in place. False, with the .idx
+    // untouched, when it cannot be read back or reopened for writing.
+    bool extend_index(const CsvIndexHeader& old);
+
+    // The CSV mapping to scan: csv_map_ when map_csv is on, else scratch
+    const MappedFile& scan_mapping(MappedFile& scratch) const;
+
+    // Start offsets of the rows after the one starting at begin, up to end;
+    // begin must be a row start. Large ranges are split across threads.
+    std::vector<uint64_t> find_row_starts(const MappedFile& csv, uint64_t begin, uint64_t end) const;
+    static uint64_t tail_fingerprint(const char* data, uint64_t size);
+    std::size_t index_chunk_count(uint64_t size) const;
+    static void scan_chunk(const char* data, uint64_t begin, uint64_t end,
+                           ChunkScan& out);
+
+    uint64_t row_offset(std::size_t row_index) const;
+    uint64_t row_end(std::size_t row_index) const;
+
+    // Whether the row exists; during a background build this waits until
+    // the row is indexed or the build is over
+    bool has_row(std::size_t row_index) const;
+
+    // Rows a query has to visit once the indexes have had their say
+    struct ScanPlan {
+        bool narrowed = false;          // rows holds the candidates
+        bool exact = false;             // every candidate is a match
+        bool following = false;         // the index is still being built: scan what it
+                                        // has published and wait for more (count is unbounded)
+        std::shared_ptr<IndexBuild> build;  // when following; outlives an adopt_index mid-scan
+        query::RowBitmap candidates;
+        std::vector<uint32_t> rows;     // candidates, in order
+        std::size_t count = 0;          // positions to visit
+
+        // Set when the matches go to the result cache: each scan() files
+        // the rows it matched under its first position
+        struct Recording {
+            std::string key;
+            uint64_t fingerprint = 0;
+            std::mutex mutex;
+            std::vector<std::pair<std::size_t, std::vector<uint32_t>>> pieces;
+        };
+        std::unique_ptr<Recording> recording;
+
+        std::size_t row_at(std::size_t p) const { return narrowed ? rows[p] : p; }
+    };
+
+    // Called with each matching row index and the reader that can fetch
+    // its text; false stops the scan
+    using MatchFn = std::function<bool(std::size_t, RowReader&)>;
+
+    // Bind q, consult the result cache and the indexes and reset
+    // last_query_stats_
+    ScanPlan plan_scan(query::Query& q);
+
+    // Context to read the fields of matching rows from: bound to the column
+    // cache when it is loaded, else split up to maxColumn
+    query::RowContext field_context(int maxColumn) const;
+    void load_fields(query::RowContext& context, int maxColumn,
+                     std::size_t row, RowReader& reader) const;
+    void project(query::RowContext& context, const query::Projection& projection,
+                 std::size_t row, RowReader& reader, query::ProjectedRow& out) const;
+
+    // Visit positions [begin, end) of plan; returns how many were visited
+    std::size_t scan(query::Query& q, const ScanPlan& plan,
+                     std::size_t begin, std::size_t end, const MatchFn& on_match) const;
+    std::size_t scan_range(query::Query& q, const ScanPlan& plan, std::size_t begin, std::size_t end,
+                           RowReader& reader, const MatchFn& on_match) const;
+
+    // Record the matches of a finished scan in last_query_stats_ and, when
+    // every position was visited, in the result cache; a scan that followed
+    // a background build also learns how many rows it saw
+    void finish_scan(const ScanPlan& plan, std::size_t matched);
+
+    // Split [0, count) into contiguous shards and run fn(shard, begin, end)
+    // for each one on the query thread pool
+    std::size_t query_shard_count(std::size_t count) const;
+    void for_each_shard(std::size_t shards, std::size_t count,
+                        const std::function<void(std::size_t, std::size_t, std::size_t)>& fn);
+    void save_index(const std::vector<uint64_t>& offsets, uint64_t fileSize, uint64_t tailHash);
     void map_index();
 
     static uint64_t file_size(const std::string& path);
@@ -0,0 +1,217 @@
+#include "CsvRangeIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+// ---------- build ----------
+
+void CsvRangeIndex::build(const std::string& path, const CsvColumnCache& columns,
+                          const std::vector<int>& csvColumns, uint64_t fileSize)
+{
+    const std::size_t rows = columns.row_count();
+
+    std::vector<int> indexed(csvColumns);
+    std::sort(indexed.begin(), indexed.end());
+    indexed.erase(std::unique(indexed.begin(), indexed.end()), indexed.end());
+
+    std::vector<CsvRangeColumnEntry> entries;
+    std::vector<std::vector<double>> values;
+    std::vector<std::vector<uint32_t>> rowIds;
+
+    for (int column : indexed) {
+        const auto* entry = columns.column(column);
+        if (!entry)
+            throw std::invalid_argument("Column is not in the column cache");
+
+        const auto encoding = static_cast<ColumnEncoding>(entry->encoding);
+        if (encoding != ColumnEncoding::F64 && encoding != ColumnEncoding::I32
+            && encoding != ColumnEncoding::DATE)
+            throw std::invalid_argument("Range indexes need a numeric or date column");
+
+        // Rows missing the field never satisfy a range, so they are left out
+        std::vector<std::pair<double, uint32_t>> sorted;
+        sorted.reserve(rows);
+        for (std::size_t r = 0; r < rows; ++r) {
+            if (column >= columns.field_count(r))
+                continue;
+            const double value = columns.number(r, column);
+            if (!std::isnan(value))
+                sorted.emplace_back(value, static_cast<uint32_t>(r));
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        CsvRangeColumnEntry e;
+        e.csv_column = static_cast<uint32_t>(column);
+        e.count = sorted.size();
+        entries.push_back(e);
+
+        values.emplace_back();
+        rowIds.emplace_back();
+        values.back().reserve(sorted.size());
+        rowIds.back().reserve(sorted.size());
+        for (const auto& [value, row] : sorted) {
+            values.back().push_back(value);
+            rowIds.back().push_back(row);
+        }
+    }
+
+    CsvRangeIndexHeader h;
+    h.file_size = fileSize;
+    h.row_count = rows;
+    h.column_count = entries.size();
+
+    // Value arrays first so every double stays 8-byte aligned
+    uint64_t offset = sizeof(h) + entries.size() * sizeof(CsvRangeColumnEntry);
+    for (auto& e : entries) {
+        e.values_offset = offset;
+        offset += e.count * sizeof(double);
+    }
+    for (auto& e : entries) {
+        e.rows_offset = offset;
+        offset += e.count * sizeof(uint32_t);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Failed to write range index");
+
+    // The header is written last; until then the index fails to load and
+    // an interrupted build is redone on the next open
+    CsvRangeIndexHeader pending;
+    pending.magic = 0;
+    out.write(reinterpret_cast<const char*>(&pending), sizeof(pending));
+    out.write(reinterpret_cast<const char*>(entries.data()),
+              static_cast<std::streamsize>(entries.size() * sizeof(CsvRangeColumnEntry)));
+    for (const auto& v : values)
+        out.write(reinterpret_cast<const char*>(v.data()),
+                  static_cast<std::streamsize>(v.size() * sizeof(double)));
+    for (const auto& r : rowIds)
+        out.write(reinterpret_cast<const char*>(r.data()),
+                  static_cast<std::streamsize>(r.size() * sizeof(uint32_t)));
+
+    out.flush();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.close();
+    if (!out) throw std::runtime_error("Failed to write range index");
+}
+
+// ---------- load ----------
+
+bool CsvRangeIndex::load(const std::string& path, uint64_t fileSize, uint64_t rowCount,
+                         const std::vector<int>& csvColumns)
+{
+    {
+        CsvRangeIndexHeader h{};
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (!in)
+            return false;
+
+        const CsvRangeIndexHeader expected{};
+        if (h.magic != expected.magic) return false;
+        if (h.version != expected.version) return false;
+        if (h.file_size != fileSize) return false;
+        if (h.row_count != rowCount) return false;
+    }
+
+    map_.open(path);
+    header_ = reinterpret_cast<const CsvRangeIndexHeader*>(map_.data());
+    entries_ = reinterpret_cast<const CsvRangeColumnEntry*>(map_.data() + sizeof(CsvRangeIndexHeader));
+
+    bool usable = entries_fit();
+    for (int column : csvColumns)
+        usable = usable && find(column);
+
+    if (!usable) {
+        map_.close();
+        header_ = nullptr;
+        entries_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// The directory and every value and row array it points at lie in the file
+bool CsvRangeIndex::entries_fit() const
+{
+    const uint64_t size = map_.size();
+    if (header_->column_count > (size - sizeof(CsvRangeIndexHeader)) / sizeof(CsvRangeColumnEntry))
+        return false;
+
+    for (uint64_t c = 0; c < header_->column_count; ++c) {
+        const CsvRangeColumnEntry& e = entries_[c];
+        if (e.count > header_->row_count)
+            return false;
+        if (e.values_offset > size || e.count > (size - e.values_offset) / sizeof(double))
+            return false;
+        if (e.rows_offset > size || e.count > (size - e.rows_offset) / sizeof(uint32_t))
+            return false;
+    }
+    return true;
+}
+
+// ---------- lookup ----------
+
+std::size_t CsvRangeIndex::row_count() const
+{
+    return header_ ? static_cast<std::size_t>(header_->row_count) : 0;
+}
+
+const CsvRangeColumnEntry* CsvRangeIndex::find(int column) const
+{
+    if (!header_ || column < 0)
+        return nullptr;
+
+    const auto* end = entries_ + header_->column_count;
+    const auto* it = std::lower_bound(entries_, end, static_cast<uint32_t>(column),
+        [](const CsvRangeColumnEntry& e, uint32_t c) { return e.csv_column < c; });
+
+    return (it != end && it->csv_column == static_cast<uint32_t>(column)) ? it : nullptr;
+}
+
+std::pair<std::size_t, std::size_t> CsvRangeIndex::bounds(const CsvRangeColumnEntry& e,
+                                                          double lo, double hi) const
+{
+    if (!(lo <= hi))
+        return {0, 0};
+
+    const auto* values = reinterpret_cast<const double*>(map_.data() + e.values_offset);
+    const auto* end = values + e.count;
+    const auto* first = std::lower_bound(values, end, lo);
+    const auto* last = std::upper_bound(first, end, hi);
+    return {static_cast<std::size_t>(first - values), static_cast<std::size_t>(last - values)};
+}
+
+std::optional<std::size_t> CsvRangeIndex::range_count(int column, double lo, double hi) const
+{
+    const auto* e = find(column);
+    if (!e)
+        return std::nullopt;
+
+    auto [first, last] = bounds(*e, lo, hi);
+    return last - first;
+}
+
+std::optional<query::RowBitmap> CsvRangeIndex::range_rows(int column, double lo, double hi) const
+{
+    const auto* e = find(column);
+    if (!e)
+        return std::nullopt;
+
+    auto [first, last] = bounds(*e, lo, hi);
+    const auto* rows = reinterpret_cast<const uint32_t*>(map_.data() + e->rows_offset);
+
+    // The bitmap takes rows in increasing order
+    std::vector<uint32_t> matches(rows + first, rows + last);
+    std::sort(matches.begin(), matches.end());
+
+    query::RowBitmap result;
+    for (uint32_t row : matches)
+        result.add(row);
+    return result;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "CsvColumnCache.hpp"
+#include "MappedFile.hpp"
+#include "../query/Querys.hpp"
+
+// Persisted sorted (value, row) lists (<csv>.rng) for selected numeric and
+// date columns of the column cache, so a range predicate becomes two
+// binary searches. Invalidated like the row index.
+struct CsvRangeIndexHeader {
+    uint64_t magic = 0x435356524E473031ULL; // CSVRNG01
+    uint64_t version = 3;
+    uint64_t file_size = 0;
+    uint64_t row_count = 0;
+    uint64_t column_count = 0;
+};
+
+// One indexed column; entries are sorted by csv_column
+struct CsvRangeColumnEntry {
+    uint32_t csv_column = 0;
+    uint32_t reserved = 0;
+    uint64_t count = 0;             // rows holding a value
+    uint64_t values_offset = 0;     // double[count], ascending
+    uint64_t rows_offset = 0;       // uint32_t[count], row of each value
+};
+
+class CsvRangeIndex : public query::IndexSource {
+public:
+    static void build(const std::string& path, const CsvColumnCache& columns,
+                      const std::vector<int>& csvColumns, uint64_t fileSize);
+
+    // False if the sidecar is missing, stale, or lacks one of csvColumns
+    bool load(const std::string& path, uint64_t fileSize, uint64_t rowCount,
+              const std::vector<int>& csvColumns);
+    bool is_loaded() const { return map_.is_open(); }
+
+    std::size_t row_count() const override;
+    std::optional<std::size_t> range_count(int column, double lo, double hi) const override;
+    std::optional<query::RowBitmap> range_rows(int column, double lo, double hi) const override;
+
+private:
+    MappedFile map_;
+    const CsvRangeIndexHeader* header_ = nullptr;
+    const CsvRangeColumnEntry* entries_ = nullptr;
+
+    const CsvRangeColumnEntry* find(int column) const;
+    bool entries_fit() const;
+
+    // Positions [first, last) of the values in [lo, hi]
+    std::pair<std::size_t, std::size_t> bounds(const CsvRangeColumnEntry& e,
+                                               double lo, double hi) const;
+};
@@ -0,0 +1,66 @@
+#include "CsvResultCache.hpp"
+
+#include <iterator>
+
+const query::RowBitmap* CsvResultCache::find(const std::string& key, uint64_t fingerprint,
+                                             uint64_t fileSize, uint64_t rowCount)
+{
+    if (fileSize != file_size_ || rowCount != row_count_) {
+        invalidate();
+        file_size_ = fileSize;
+        row_count_ = rowCount;
+    }
+
+    // Distinct forms can share a fingerprint, so the key itself decides
+    auto it = index_.find(fingerprint);
+    if (it == index_.end() || it->second->key != key) {
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++stats_.hits;
+    return &it->second->rows;
+}
+
+void CsvResultCache::insert(const std::string& key, uint64_t fingerprint, query::RowBitmap rows)
+{
+    const std::size_t bytes = rows.memory_bytes() + key.capacity() + sizeof(Entry);
+    if (bytes > max_bytes_)
+        return;
+
+    // A colliding form replaces the older entry
+    if (auto it = index_.find(fingerprint); it != index_.end())
+        erase(it->second);
+
+    while (stats_.bytes + bytes > max_bytes_)
+        erase(std::prev(lru_.end()));
+
+    lru_.push_front(Entry{key, fingerprint, std::move(rows), bytes});
+    index_.emplace(fingerprint, lru_.begin());
+    stats_.bytes += bytes;
+    ++stats_.entries;
+}
+
+void CsvResultCache::invalidate()
+{
+    if (!lru_.empty())
+        ++stats_.invalidations;
+    clear();
+}
+
+void CsvResultCache::clear()
+{
+    lru_.clear();
+    index_.clear();
+    stats_.entries = 0;
+    stats_.bytes = 0;
+}
+
+void CsvResultCache::erase(std::list<Entry>::iterator it)
+{
+    stats_.bytes -= it->bytes;
+    --stats_.entries;
+    index_.erase(it->fingerprint);
+    lru_.erase(it);
+}
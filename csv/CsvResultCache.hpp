@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "../query/RowBitmap.hpp"
+
+struct CsvResultCacheStats {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t invalidations = 0;  // times the cached file state went stale
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+};
+
+// In-memory LRU of query results (matching row ids), keyed by
+// Query::canonical() and looked up by its fingerprint. Bounded by the
+// memory the row sets take. Entries belong to one state of the CSV, given
+// by the file size and row count of its index; a lookup for any other
+// state drops them all.
+class CsvResultCache {
+public:
+    explicit CsvResultCache(std::size_t maxBytes = 0) : max_bytes_(maxBytes) {}
+
+    bool enabled() const { return max_bytes_ > 0; }
+
+    // The rows cached for key in the given file state, or nullptr (a
+    // miss). Valid until the next insert() or clear().
+    const query::RowBitmap* find(const std::string& key, uint64_t fingerprint,
+                                 uint64_t fileSize, uint64_t rowCount);
+
+    // Cache rows for key, evicting the least recently used entries until
+    // it fits; a set larger than the whole budget is not kept
+    void insert(const std::string& key, uint64_t fingerprint, query::RowBitmap rows);
+
+    void clear();
+
+    // clear() because the CSV changed; counted in stats().invalidations
+    void invalidate();
+
+    const CsvResultCacheStats& stats() const { return stats_; }
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t fingerprint = 0;
+        query::RowBitmap rows;
+        std::size_t bytes = 0;
+    };
+
+    std::size_t max_bytes_;
+    uint64_t file_size_ = 0;
+    uint64_t row_count_ = 0;
+
+    std::list<Entry> lru_;     // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+    CsvResultCacheStats stats_;
+
+    void erase(std::list<Entry>::iterator it);
+};
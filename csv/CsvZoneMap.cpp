@@ -0,0 +1,363 @@
+#include "CsvZoneMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "../dob/DobCsv.hpp"
+#include "../dob/DobParseUtils.hpp"
+
+namespace {
+
+// FNV-1a, so the persisted filters do not depend on the standard library
+uint64_t hash_value(std::string_view value)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (unsigned char c : value) {
+        h ^= c;
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+// Two probes into the 256-bit filter
+void bloom_probes(std::string_view value, unsigned& a, unsigned& b)
+{
+    const uint64_t h = hash_value(value);
+    a = static_cast<unsigned>(h & 255);
+    b = static_cast<unsigned>((h >> 32) & 255);
+}
+
+bool bloom_test(const CsvZoneBloom& bloom, unsigned bit)
+{
+    return (bloom.bits[bit >> 6] >> (bit & 63)) & 1u;
+}
+
+} // namespace
+
+// ---------- build ----------
+
+namespace {
+
+using ZoneColumns = std::vector<std::pair<int, dob::ColumnCategory>>;
+
+// Every non-boolean schema column, once per CSV column, in column order
+ZoneColumns zone_columns()
+{
+    std::map<int, dob::ColumnCategory> by_index;
+    for (const auto& column : dob::COLUMN_SCHEMA) {
+        if (column.category != dob::ColumnCategory::BOOLEAN)
+            by_index.emplace(column.csv_index, column.category);
+    }
+    return ZoneColumns(by_index.begin(), by_index.end());
+}
+
+// Summaries of every column, per block; one of the two is used per column
+struct ZoneSummaries {
+    std::vector<std::vector<CsvZoneRange>> ranges;
+    std::vector<std::vector<CsvZoneBloom>> blooms;
+
+    // Size every column for blocks, keeping the first keep blocks and
+    // emptying the others
+    void resize(const ZoneColumns& columns, std::size_t keep, std::size_t blocks)
+    {
+        constexpr double inf = std::numeric_limits<double>::infinity();
+        ranges.resize(columns.size());
+        blooms.resize(columns.size());
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            if (columns[c].second == dob::ColumnCategory::STRING) {
+                blooms[c].resize(keep);
+                blooms[c].resize(blocks);
+            } else {
+                ranges[c].resize(keep);
+                ranges[c].resize(blocks, CsvZoneRange{inf, -inf});
+            }
+        }
+    }
+
+    // Fold rows [first, rowCount) into their blocks
+    void add_rows(const ZoneColumns& columns, std::size_t first, std::size_t rowCount,
+                  const CsvZoneMap::RowFn& row)
+    {
+        const int max_column = columns.back().first;
+        std::vector<std::string_view> fields;
+        std::string unescaped;
+        for (std::size_t i = first; i < rowCount; ++i) {
+            dob::split_csv_line(row(i), fields, static_cast<std::size_t>(max_column) + 1);
+            const std::size_t block = i / CsvZoneMap::kBlockRows;
+
+            for (std::size_t c = 0; c < columns.size(); ++c) {
+                const auto [column, category] = columns[c];
+                if (column >= static_cast<int>(fields.size()))
+                    continue;
+                const std::string_view raw = fields[static_cast<std::size_t>(column)];
+
+                if (category == dob::ColumnCategory::STRING) {
+                    unsigned a, b;
+                    bloom_probes(dob::field_text(raw, unescaped), a, b);
+                    auto& bloom = blooms[c][block];
+                    bloom.bits[a >> 6] |= uint64_t{1} << (a & 63);
+                    bloom.bits[b >> 6] |= uint64_t{1} << (b & 63);
+                    continue;
+                }
+
+                const double value = category == dob::ColumnCategory::DATE
+                    ? static_cast<double>(dob::parse_date(dob::unquote(raw)))
+                    : dob::parse_number(raw, column);
+                if (std::isnan(value))
+                    continue;
+                auto& range = ranges[c][block];
+                range.min = std::min(range.min, value);
+                range.max = std::max(range.max, value);
+            }
+        }
+    }
+
+    void write(const std::string& path, const ZoneColumns& columns,
+               uint64_t fileSize, std::size_t rowCount, std::size_t blocks) const
+    {
+        CsvZoneMapHeader h;
+        h.file_size = fileSize;
+        h.row_count = rowCount;
+        h.block_rows = CsvZoneMap::kBlockRows;
+        h.block_count = blocks;
+        h.column_count = columns.size();
+
+        std::vector<CsvZoneColumnEntry> entries(columns.size());
+        uint64_t offset = sizeof(h) + entries.size() * sizeof(CsvZoneColumnEntry);
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            const bool bloom = columns[c].second == dob::ColumnCategory::STRING;
+            entries[c].csv_column = static_cast<uint32_t>(columns[c].first);
+            entries[c].kind = static_cast<uint32_t>(bloom ? ZoneKind::BLOOM : ZoneKind::MIN_MAX);
+            entries[c].offset = offset;
+            offset += blocks * (bloom ? sizeof(CsvZoneBloom) : sizeof(CsvZoneRange));
+        }
+
+        // Written aside and renamed over path, so an interrupted build or
+        // extend never leaves a short file behind a valid header
+        const std::string tmp_path = path + ".tmp";
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Failed to write zone map");
+
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(entries.data()),
+                  static_cast<std::streamsize>(entries.size() * sizeof(CsvZoneColumnEntry)));
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            if (columns[c].second == dob::ColumnCategory::STRING)
+                out.write(reinterpret_cast<const char*>(blooms[c].data()),
+                          static_cast<std::streamsize>(blooms[c].size() * sizeof(CsvZoneBloom)));
+            else
+                out.write(reinterpret_cast<const char*>(ranges[c].data()),
+                          static_cast<std::streamsize>(ranges[c].size() * sizeof(CsvZoneRange)));
+        }
+
+        out.close();
+        if (!out) throw std::runtime_error("Failed to write zone map");
+        std::filesystem::rename(tmp_path, path);
+    }
+};
+
+std::size_t block_count_for(std::size_t rowCount)
+{
+    return (rowCount + CsvZoneMap::kBlockRows - 1) / CsvZoneMap::kBlockRows;
+}
+
+} // namespace
+
+void CsvZoneMap::build(const std::string& path, uint64_t fileSize,
+                       std::size_t rowCount, const RowFn& row)
+{
+    const ZoneColumns columns = zone_columns();
+    const std::size_t blocks = block_count_for(rowCount);
+
+    ZoneSummaries summaries;
+    summaries.resize(columns, 0, blocks);
+    summaries.add_rows(columns, 0, rowCount, row);
+    summaries.write(path, columns, fileSize, rowCount, blocks);
+}
+
+bool CsvZoneMap::extend(const std::string& path, uint64_t oldFileSize, std::size_t oldRowCount,
+                        uint64_t fileSize, std::size_t rowCount, const RowFn& row)
+{
+    if (oldRowCount == 0 || rowCount < oldRowCount)
+        return false;
+
+    const ZoneColumns columns = zone_columns();
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+
+    CsvZoneMapHeader h{};
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    const CsvZoneMapHeader expected{};
+    if (!in || h.magic != expected.magic || h.version != expected.version
+        || h.file_size != oldFileSize || h.row_count != oldRowCount
+        || h.block_rows != kBlockRows || h.column_count != columns.size())
+        return false;
+
+    std::vector<CsvZoneColumnEntry> entries(columns.size());
+    in.read(reinterpret_cast<char*>(entries.data()),
+            static_cast<std::streamsize>(entries.size() * sizeof(CsvZoneColumnEntry)));
+    if (!in)
+        return false;
+
+    // The block holding the old last row is summarized again: an append
+    // can continue that row when the CSV did not end in a newline
+    const std::size_t keep = (oldRowCount - 1) / kBlockRows;
+    const std::size_t blocks = block_count_for(rowCount);
+
+    ZoneSummaries summaries;
+    summaries.resize(columns, keep, blocks);
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        if (entries[c].csv_column != static_cast<uint32_t>(columns[c].first))
+            return false;
+
+        in.seekg(static_cast<std::streamoff>(entries[c].offset));
+        if (columns[c].second == dob::ColumnCategory::STRING)
+            in.read(reinterpret_cast<char*>(summaries.blooms[c].data()),
+                    static_cast<std::streamsize>(keep * sizeof(CsvZoneBloom)));
+        else
+            in.read(reinterpret_cast<char*>(summaries.ranges[c].data()),
+                    static_cast<std::streamsize>(keep * sizeof(CsvZoneRange)));
+        if (!in)
+            return false;
+    }
+    in.close();
+
+    summaries.add_rows(columns, keep * kBlockRows, rowCount, row);
+    summaries.write(path, columns, fileSize, rowCount, blocks);
+    return true;
+}
+
+// ---------- load ----------
+
+bool CsvZoneMap::load(const std::string& path, uint64_t fileSize, uint64_t rowCount)
+{
+    {
+        CsvZoneMapHeader h{};
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (!in)
+            return false;
+
+        const CsvZoneMapHeader expected{};
+        if (h.magic != expected.magic) return false;
+        if (h.version != expected.version) return false;
+        if (h.file_size != fileSize) return false;
+        if (h.row_count != rowCount) return false;
+        if (h.block_rows != kBlockRows) return false;
+    }
+
+    map_.open(path);
+    header_ = reinterpret_cast<const CsvZoneMapHeader*>(map_.data());
+    entries_ = reinterpret_cast<const CsvZoneColumnEntry*>(map_.data() + sizeof(CsvZoneMapHeader));
+
+    if (!sections_fit()) {
+        map_.close();
+        header_ = nullptr;
+        entries_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// Every section the header and the directory point at lies in the file
+bool CsvZoneMap::sections_fit() const
+{
+    const uint64_t size = map_.size();
+    if (header_->block_count != (header_->row_count + kBlockRows - 1) / kBlockRows)
+        return false;
+    if (header_->column_count > (size - sizeof(CsvZoneMapHeader)) / sizeof(CsvZoneColumnEntry))
+        return false;
+
+    for (uint64_t c = 0; c < header_->column_count; ++c) {
+        const CsvZoneColumnEntry& e = entries_[c];
+        uint64_t width;
+        if (e.kind == static_cast<uint32_t>(ZoneKind::MIN_MAX))
+            width = sizeof(CsvZoneRange);
+        else if (e.kind == static_cast<uint32_t>(ZoneKind::BLOOM))
+            width = sizeof(CsvZoneBloom);
+        else
+            return false;
+
+        if (e.offset > size || header_->block_count > (size - e.offset) / width)
+            return false;
+    }
+    return true;
+}
+
+// ---------- lookup ----------
+
+std::size_t CsvZoneMap::row_count() const
+{
+    return header_ ? static_cast<std::size_t>(header_->row_count) : 0;
+}
+
+std::size_t CsvZoneMap::block_count() const
+{
+    return header_ ? static_cast<std::size_t>(header_->block_count) : 0;
+}
+
+const CsvZoneColumnEntry* CsvZoneMap::find(int column, ZoneKind kind) const
+{
+    if (!header_ || column < 0)
+        return nullptr;
+
+    const auto* end = entries_ + header_->column_count;
+    const auto* it = std::lower_bound(entries_, end, static_cast<uint32_t>(column),
+        [](const CsvZoneColumnEntry& e, uint32_t c) { return e.csv_column < c; });
+
+    if (it == end || it->csv_column != static_cast<uint32_t>(column)
+        || it->kind != static_cast<uint32_t>(kind))
+        return nullptr;
+    return it;
+}
+
+template <typename Fn>
+query::RowBitmap CsvZoneMap::blocks_where(Fn&& admits) const
+{
+    const auto rows = static_cast<uint32_t>(header_->row_count);
+    query::RowBitmap result;
+    for (std::size_t b = 0; b < header_->block_count; ++b) {
+        if (admits(b)) {
+            const auto begin = static_cast<uint32_t>(b * kBlockRows);
+            result.add_range(begin, std::min<uint32_t>(rows, begin + static_cast<uint32_t>(kBlockRows)));
+        }
+    }
+    return result;
+}
+
+std::optional<query::RowBitmap> CsvZoneMap::zone_rows(int column, double lo, double hi) const
+{
+    const auto* e = find(column, ZoneKind::MIN_MAX);
+    if (!e)
+        return std::nullopt;
+
+    const auto* ranges = reinterpret_cast<const CsvZoneRange*>(map_.data() + e->offset);
+    return blocks_where([&](std::size_t b) {
+        return ranges[b].min <= hi && ranges[b].max >= lo;
+    });
+}
+
+std::optional<query::RowBitmap> CsvZoneMap::zone_rows(int column, std::string_view value) const
+{
+    const auto* e = find(column, ZoneKind::BLOOM);
+    if (!e)
+        return std::nullopt;
+
+    unsigned a, b;
+    bloom_probes(value, a, b);
+    const auto* blooms = reinterpret_cast<const CsvZoneBloom*>(map_.data() + e->offset);
+    return blocks_where([&](std::size_t block) {
+        return bloom_test(blooms[block], a) && bloom_test(blooms[block], b);
+    });
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "MappedFile.hpp"
+#include "../query/Querys.hpp"
+
+// Per-block summaries (<csv>.zone) of every COLUMN_SCHEMA column: min/max
+// for numeric and date columns, a small Bloom filter of the values for
+// string columns. Lets a scan skip blocks that cannot hold a match.
+// Invalidated like the row index.
+struct CsvZoneMapHeader {
+    uint64_t magic = 0x4353565A4F4E3031ULL; // CSVZON01
+    uint64_t version = 4;
+    uint64_t file_size = 0;
+    uint64_t row_count = 0;
+    uint64_t block_rows = 0;
+    uint64_t block_count = 0;
+    uint64_t column_count = 0;
+};
+
+enum class ZoneKind : uint32_t {
+    MIN_MAX = 0,    // CsvZoneRange[block_count]
+    BLOOM = 1,      // CsvZoneBloom[block_count]
+};
+
+struct CsvZoneColumnEntry {
+    uint32_t csv_column = 0;
+    uint32_t kind = 0;
+    uint64_t offset = 0;
+};
+
+// Values of the rows holding the field; min > max for a block without any
+struct CsvZoneRange {
+    double min = 0.0;
+    double max = 0.0;
+};
+
+struct CsvZoneBloom {
+    uint64_t bits[4] = {};
+};
+
+class CsvZoneMap : public query::IndexSource {
+public:
+    static constexpr std::size_t kBlockRows = 4096;
+
+    // Reads row i of the CSV (without its terminator)
+    using RowFn = std::function<std::string_view(std::size_t)>;
+
+    static void build(const std::string& path, uint64_t fileSize,
+                      std::size_t rowCount, const RowFn& row);
+
+    // Bring a zone map built for the first oldRowCount rows of the CSV up
+    // to date after an append, summarizing only the new rows (and the last
+    // old block again). False when the file at path does not match the old
+    // version of the CSV.
+    static bool extend(const std::string& path, uint64_t oldFileSize, std::size_t oldRowCount,
+                       uint64_t fileSize, std::size_t rowCount, const RowFn& row);
+
+    bool load(const std::string& path, uint64_t fileSize, uint64_t rowCount);
+    bool is_loaded() const { return map_.is_open(); }
+
+    std::size_t row_count() const override;
+    std::size_t block_count() const;
+
+    std::optional<query::RowBitmap> zone_rows(int column, double lo, double hi) const override;
+    std::optional<query::RowBitmap> zone_rows(int column, std::string_view value) const override;
+
+private:
+    MappedFile map_;
+    const CsvZoneMapHeader* header_ = nullptr;
+    const CsvZoneColumnEntry* entries_ = nullptr;
+
+    const CsvZoneColumnEntry* find(int column, ZoneKind kind) const;
+    bool sections_fit() const;
+
+    // Rows of the blocks for which admits(block) holds
+    template <typename Fn>
+    query::RowBitmap blocks_where(Fn&& admits) const;
+};
@@ -0,0 +1,152 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+#include <utility>
+
+MappedFile::MappedFile(const std::string& path)
+{
+    open(path);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        swap(other);
+    }
+    return *this;
+}
+
+void MappedFile::swap(MappedFile& other) noexcept
+{
+#ifdef _WIN32
+    std::swap(handle_, other.handle_);
+#else
+    std::swap(fd_, other.fd_);
+#endif
+    std::swap(mem_, other.mem_);
+    std::swap(size_, other.size_);
+    std::swap(open_, other.open_);
+}
+
+void MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("open failed: " + path);
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("GetFileSizeEx failed");
+    }
+
+    size_ = static_cast<std::size_t>(size.QuadPart);
+
+    // Zero-length files cannot be mapped; treat them as an empty view
+    if (size_ == 0) {
+        CloseHandle(file);
+        open_ = true;
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+
+    if (!mapping) {
+        throw std::runtime_error("CreateFileMapping failed");
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        throw std::runtime_error("MapViewOfFile failed");
+    }
+
+    handle_ = mapping;
+    mem_ = view;
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+        throw std::runtime_error("open failed: " + path);
+
+    struct stat st{};
+    if (fstat(fd_, &st) != 0) {
+        close();
+        throw std::runtime_error("fstat failed");
+    }
+
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    // Zero-length files cannot be mapped; treat them as an empty view
+    if (size_ == 0) {
+        open_ = true;
+        return;
+    }
+
+    mem_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mem_ == MAP_FAILED) {
+        mem_ = nullptr;
+        close();
+        throw std::runtime_error("mmap failed");
+    }
+#endif
+
+    open_ = true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (mem_) {
+        UnmapViewOfFile(mem_);
+        mem_ = nullptr;
+    }
+    if (handle_) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = nullptr;
+    }
+#else
+    if (mem_) {
+        munmap(mem_, size_);
+        mem_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+    size_ = 0;
+    open_ = false;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of an entire file
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    void open(const std::string& path);
+    void close();
+
+    bool is_open() const { return open_; }
+    const char* data() const { return static_cast<const char*>(mem_); }
+    std::size_t size() const { return size_; }
+    std::string_view view() const { return {data(), size_}; }
+
+private:
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    void* mem_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_ = false;
+
+    void swap(MappedFile& other) noexcept;
+};
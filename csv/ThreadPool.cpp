@@ -0,0 +1,85 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(std::size_t workers)
+{
+    workers_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i)
+        workers_.emplace_back([this]() { worker_loop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& w : workers_)
+        w.join();
+}
+
+void ThreadPool::parallel_for(std::size_t tasks, const std::function<void(std::size_t)>& fn)
+{
+    if (tasks == 0)
+        return;
+
+    if (workers_.empty() || tasks == 1) {
+        for (std::size_t t = 0; t < tasks; ++t)
+            fn(t);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &fn;
+    job_tasks_ = tasks;
+    next_task_ = 0;
+    finished_tasks_ = 0;
+    error_ = nullptr;
+    ++generation_;
+    wake_.notify_all();
+
+    drain(lock);
+    done_.wait(lock, [this]() { return finished_tasks_ == job_tasks_; });
+
+    job_ = nullptr;
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+void ThreadPool::worker_loop()
+{
+    std::size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+        wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+        if (stop_)
+            return;
+
+        seen = generation_;
+        drain(lock);
+    }
+}
+
+// Claim and run tasks of the current job until none are left
+void ThreadPool::drain(std::unique_lock<std::mutex>& lock)
+{
+    while (job_ && next_task_ < job_tasks_) {
+        const std::size_t task = next_task_++;
+        const auto* fn = job_;
+
+        lock.unlock();
+        try {
+            (*fn)(task);
+        } catch (...) {
+            lock.lock();
+            if (!error_)
+                error_ = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+
+        if (++finished_tasks_ == job_tasks_)
+            done_.notify_all();
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run blocking parallel-for jobs.
+// The calling thread takes part in every job, so a pool of N workers
+// gives N + 1 way parallelism.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t concurrency() const { return workers_.size() + 1; }
+
+    // Run fn(task) for every task in [0, tasks) and wait for all of them.
+    // The first exception thrown by a task is rethrown here.
+    void parallel_for(std::size_t tasks, const std::function<void(std::size_t)>& fn);
+
+private:
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    const std::function<void(std::size_t)>* job_ = nullptr;
+    std::size_t job_tasks_ = 0;
+    std::size_t next_task_ = 0;
+    std::size_t finished_tasks_ = 0;
+    std::size_t generation_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+
+    void worker_loop();
+    void drain(std::unique_lock<std::mutex>& lock);
+};
@@ -0,0 +1,83 @@
+#include "DobArena.hpp"
+
+#include <cstring>
+#include <iterator>
+
+namespace dob {
+
+    Arena::Arena(std::size_t chunkSize) : chunkSize_(chunkSize ? chunkSize : kDefaultChunkSize) {}
+
+    char* Arena::allocate(std::size_t n) {
+        bytesUsed_ += n;
+
+        // Oversized requests get a chunk of their own, slotted in behind the
+        // one being filled so its free tail is not wasted
+        if (n > chunkSize_) {
+            Chunk big{std::make_unique<char[]>(n), n};
+            char* p = big.data.get();
+            chunks_.insert(chunks_.empty() ? chunks_.end() : std::prev(chunks_.end()), std::move(big));
+            if (chunks_.size() == 1) {
+                offset_ = n;
+            }
+            return p;
+        }
+
+        if (chunks_.empty() || chunks_.back().size - offset_ < n) {
+            chunks_.push_back(Chunk{std::make_unique<char[]>(chunkSize_), chunkSize_});
+            offset_ = 0;
+        }
+        char* p = chunks_.back().data.get() + offset_;
+        offset_ += n;
+        return p;
+    }
+
+    std::string_view Arena::copy(std::string_view text) {
+        if (text.empty()) {
+            return {};
+        }
+        char* p = allocate(text.size());
+        std::memcpy(p, text.data(), text.size());
+        return {p, text.size()};
+    }
+
+    void Arena::adopt(Arena&& other) {
+        if (other.chunks_.empty()) {
+            return;
+        }
+        if (chunks_.empty()) {
+            chunks_ = std::move(other.chunks_);
+            offset_ = other.offset_;
+        } else {
+            // Keep filling our own back chunk; other's become read-only
+            chunks_.insert(std::prev(chunks_.end()),
+                           std::make_move_iterator(other.chunks_.begin()),
+                           std::make_move_iterator(other.chunks_.end()));
+        }
+        bytesUsed_ += other.bytesUsed_;
+
+        other.chunks_.clear();
+        other.offset_ = 0;
+        other.bytesUsed_ = 0;
+    }
+
+    void Arena::clear() {
+        chunks_.clear();
+        offset_ = 0;
+        bytesUsed_ = 0;
+    }
+
+    void Arena::reset() {
+        for (auto& chunk : chunks_) {
+            if (chunk.size == chunkSize_) {
+                Chunk keep = std::move(chunk);
+                chunks_.clear();
+                chunks_.push_back(std::move(keep));
+                offset_ = 0;
+                bytesUsed_ = 0;
+                return;
+            }
+        }
+        clear();
+    }
+
+}
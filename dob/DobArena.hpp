@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace dob {
+
+    // Bump allocator for result text: bytes are handed out from large chunks
+    // and only released all at once, by clear() or the destructor. Chunks
+    // never move, so views into the arena survive moving the arena itself.
+    class Arena {
+    public:
+        static constexpr std::size_t kDefaultChunkSize = 256 * 1024;
+
+        explicit Arena(std::size_t chunkSize = kDefaultChunkSize);
+
+        Arena(Arena&&) noexcept = default;
+        Arena& operator=(Arena&&) noexcept = default;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // n uninitialized bytes, valid until clear()
+        char* allocate(std::size_t n);
+
+        // A copy of text owned by the arena
+        std::string_view copy(std::string_view text);
+
+        // Take over other's chunks; views into them stay valid
+        void adopt(Arena&& other);
+
+        void clear();
+
+        // Drop every allocation but keep one chunk for reuse, so a scratch
+        // arena that is reset per row does not go back to the heap
+        void reset();
+
+        std::size_t bytes_used() const { return bytesUsed_; }
+        std::size_t chunk_count() const { return chunks_.size(); }
+
+    private:
+        struct Chunk {
+            std::unique_ptr<char[]> data;
+            std::size_t size = 0;
+        };
+
+        std::vector<Chunk> chunks_;     // the back chunk is the one being filled
+        std::size_t chunkSize_;
+        std::size_t offset_ = 0;        // bytes used in the back chunk
+        std::size_t bytesUsed_ = 0;
+    };
+
+}
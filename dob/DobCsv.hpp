@@ -1,29 +1,45 @@
 #pragma once
 
+#include <cstddef>
+#include <limits>
 #include <string_view>
 #include <vector>
 
+#include "DobCsvScan.hpp"
+
 namespace dob {
 
+    // Split one CSV row on unquoted commas. Quote state is tracked per 64-byte
+    // block with prefix_xor over the quote mask, so the loop only visits the
+    // commas that actually end a field. Splitting stops once max_fields
+    // complete fields are out; the rest of the row is left untouched.
     inline void split_csv_line(
         std::string_view line,
-        std::vector<std::string_view>& out)
+        std::vector<std::string_view>& out,
+        std::size_t max_fields = std::numeric_limits<std::size_t>::max())
     {
         out.clear();
-        size_t start = 0;
-        bool in_quotes = false;
+        std::size_t start = 0;
+        uint64_t in_quotes = 0;   // all ones while a quoted region spans blocks
 
-        for (size_t i = 0; i < line.size(); ++i) {
-            char c = line[i];
+        for_each_structural_block(line, [&](std::size_t base, const StructuralMasks& m) {
+            const uint64_t quoted = prefix_xor(m.quote) ^ in_quotes;
+            uint64_t commas = m.comma & ~quoted;
+            in_quotes = static_cast<uint64_t>(static_cast<int64_t>(quoted) >> 63);
 
-            if (c == '"') in_quotes = !in_quotes;
-            else if (c == ',' && !in_quotes) {
+            while (commas != 0) {
+                const std::size_t i = base + static_cast<std::size_t>(lowest_bit(commas));
                 out.emplace_back(line.substr(start, i - start));
                 start = i + 1;
+                if (out.size() == max_fields) return false;
+                commas &= commas - 1;
             }
-        }
+            return true;
+        });
 
-        out.emplace_back(line.substr(start));
+        if (out.size() < max_fields) {
+            out.emplace_back(line.substr(start));
+        }
     }
 
 }
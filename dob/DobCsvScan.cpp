@@ -0,0 +1,153 @@
+#include "DobCsvScan.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DOB_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DOB_SCAN_SSE2 1
+#endif
+
+#if defined(DOB_SCAN_X86) && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define DOB_SCAN_AVX2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define DOB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DOB_TARGET_AVX2
+#endif
+#endif
+
+namespace dob {
+
+    namespace {
+
+        using ClassifyFn = void (*)(const char*, std::size_t, StructuralMasks*);
+
+        void classify_scalar(const char* data, std::size_t blocks, StructuralMasks* out) {
+            for (std::size_t b = 0; b < blocks; ++b) {
+                const char* p = data + b * 64;
+                StructuralMasks m;
+                for (int i = 0; i < 64; ++i) {
+                    const uint64_t bit = uint64_t{1} << i;
+                    m.quote |= (p[i] == '"') ? bit : 0;
+                    m.comma |= (p[i] == ',') ? bit : 0;
+                    m.newline |= (p[i] == '\n') ? bit : 0;
+                }
+                out[b] = m;
+            }
+        }
+
+#ifdef DOB_SCAN_SSE2
+        void classify_sse2(const char* data, std::size_t blocks, StructuralMasks* out) {
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i comma = _mm_set1_epi8(',');
+            const __m128i newline = _mm_set1_epi8('\n');
+
+            for (std::size_t b = 0; b < blocks; ++b) {
+                const char* p = data + b * 64;
+                StructuralMasks m;
+                for (int lane = 0; lane < 4; ++lane) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + lane * 16));
+                    const int shift = lane * 16;
+                    m.quote |= static_cast<uint64_t>(static_cast<uint16_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+                    m.comma |= static_cast<uint64_t>(static_cast<uint16_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)))) << shift;
+                    m.newline |= static_cast<uint64_t>(static_cast<uint16_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)))) << shift;
+                }
+                out[b] = m;
+            }
+        }
+#endif
+
+#ifdef DOB_SCAN_AVX2
+        inline uint64_t combine_avx2(int lo, int hi) {
+            return static_cast<uint64_t>(static_cast<uint32_t>(lo))
+                | (static_cast<uint64_t>(static_cast<uint32_t>(hi)) << 32);
+        }
+
+        DOB_TARGET_AVX2
+        void classify_avx2(const char* data, std::size_t blocks, StructuralMasks* out) {
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i comma = _mm256_set1_epi8(',');
+            const __m256i newline = _mm256_set1_epi8('\n');
+
+            for (std::size_t b = 0; b < blocks; ++b) {
+                const char* p = data + b * 64;
+                const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+
+                out[b].quote = combine_avx2(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote)),
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)));
+                out[b].comma = combine_avx2(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma)),
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)));
+                out[b].newline = combine_avx2(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)),
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)));
+            }
+        }
+#endif
+
+        struct Dispatch {
+            ClassifyFn fn = classify_scalar;
+            const char* name = "scalar";
+
+            Dispatch() {
+#ifdef DOB_SCAN_SSE2
+                fn = classify_sse2;
+                name = "sse2";
+#endif
+#ifdef DOB_SCAN_AVX2
+                if (cpu_has_avx2()) {
+                    fn = classify_avx2;
+                    name = "avx2";
+                }
+#endif
+            }
+        };
+
+        const Dispatch& dispatch() {
+            static const Dispatch d;
+            return d;
+        }
+
+    }
+
+    void classify_blocks(const char* data, std::size_t blocks, StructuralMasks* out) {
+        dispatch().fn(data, blocks, out);
+    }
+
+    const char* scanner_isa() {
+        return dispatch().name;
+    }
+
+    bool cpu_has_avx2() {
+#ifdef DOB_SCAN_AVX2
+#if defined(_MSC_VER) && !defined(__clang__)
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7) return false;
+        __cpuid(regs, 1);
+        const bool osxsave = (regs[2] & (1 << 27)) != 0;
+        const bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx) return false;
+        if ((_xgetbv(0) & 0x6) != 0x6) return false;
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+#else
+        return false;
+#endif
+    }
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace dob {
+
+    // Structural characters of one 64-byte block; bit i describes byte i
+    struct StructuralMasks {
+        uint64_t quote = 0;
+        uint64_t comma = 0;
+        uint64_t newline = 0;
+    };
+
+    // Classify `blocks` consecutive 64-byte blocks starting at `data`.
+    // Dispatches once at runtime to AVX2, SSE2 or a scalar fallback.
+    void classify_blocks(const char* data, std::size_t blocks, StructuralMasks* out);
+
+    // Name of the implementation classify_blocks dispatches to
+    const char* scanner_isa();
+
+    // True when the CPU and OS support AVX2 (always false off x86)
+    bool cpu_has_avx2();
+
+    // Bit i of the result is the XOR of bits 0..i: with a quote mask as input
+    // this marks every byte that sits inside a quoted region
+    inline uint64_t prefix_xor(uint64_t bits) {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+
+    inline int lowest_bit(uint64_t bits) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+
+    // Walk `data` in 64-byte blocks, calling fn(block_offset, masks) for each.
+    // The trailing partial block is zero-padded and its masks are trimmed to
+    // the bytes that actually exist. If fn returns bool, returning false
+    // stops the walk early.
+    template <typename Fn>
+    void for_each_structural_block(std::string_view data, Fn&& fn) {
+        constexpr std::size_t kBlock = 64;
+        constexpr std::size_t kWindow = 16;
+
+        auto visit = [&](std::size_t offset, const StructuralMasks& m) {
+            if constexpr (std::is_same_v<decltype(fn(offset, m)), bool>) {
+                return fn(offset, m);
+            } else {
+                fn(offset, m);
+                return true;
+            }
+        };
+
+        StructuralMasks masks[kWindow];
+        const std::size_t full = data.size() / kBlock;
+
+        for (std::size_t b = 0; b < full; ) {
+            const std::size_t n = (full - b < kWindow) ? full - b : kWindow;
+            classify_blocks(data.data() + b * kBlock, n, masks);
+            for (std::size_t k = 0; k < n; ++k) {
+                if (!visit((b + k) * kBlock, masks[k])) return;
+            }
+            b += n;
+        }
+
+        const std::size_t rem = data.size() - full * kBlock;
+        if (rem != 0) {
+            alignas(64) char tail[kBlock] = {};
+            std::memcpy(tail, data.data() + full * kBlock, rem);
+            classify_blocks(tail, 1, masks);
+
+            const uint64_t valid = (uint64_t{1} << rem) - 1;
+            masks[0].quote &= valid;
+            masks[0].comma &= valid;
+            masks[0].newline &= valid;
+            visit(full * kBlock, masks[0]);
+        }
+    }
+
+}
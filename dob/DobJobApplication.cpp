@@ -1,52 +1,206 @@
 #include "DobJobApplication.hpp"
+#include "DobJobApplicationView.hpp"
 
 #include <vector>
 #include <limits>
 #include <charconv>
+#include <cstring>
+#include <string>
+#include <tuple>
 
 #include "DobCsv.hpp"
 #include "DobParseUtils.hpp"
+#include "DobSchema.hpp"
 
 namespace dob {
 
-    DobJobApplication parse_row(std::string_view line)
-    {
-        static thread_local std::vector<std::string_view> fields;
-        fields.reserve(100);
+    namespace {
+        // Field parsers return false when the text is malformed; empty text
+        // is a null and leaves the default value
+
+        bool parse_text(std::string& out, std::string_view raw, Arena*)
+        {
+            const std::string_view field = unquote(raw);
+            if (field.size() == raw.size() || !has_escaped_quotes(field)) {
+                out.assign(field);
+            } else {
+                // Collapse the quotes in the member's own buffer
+                out.resize(field.size());
+                out.resize(unescape_quotes(field, out.data()));
+            }
+            return true;
+        }
+
+        bool parse_text(std::string_view& out, std::string_view raw, Arena* arena)
+        {
+            const std::string_view field = unquote(raw);
+            if (field.size() == raw.size() || !has_escaped_quotes(field)) {
+                out = field;
+            } else {
+                char* dst = arena->allocate(field.size());
+                out = std::string_view(dst, unescape_quotes(field, dst));
+            }
+            return true;
+        }
+
+        template <typename T>
+        bool parse_int(T& out, std::string_view raw)
+        {
+            const std::string_view field = unquote(raw);
+            return field.empty() || parse_integer(field, out);
+        }
+
+        bool parse_money(int64_t& out, std::string_view raw)
+        {
+            const std::string_view field = unquote(raw);
+            if (field.empty()) return true;
+            if (!is_money(field)) return false;
+            out = parse_money_cents(field);
+            return true;
+        }
+
+        bool parse_date_field(Date& out, std::string_view raw)
+        {
+            const std::string_view field = unquote(raw);
+            if (field.empty()) return true;
+            if (!is_date(field)) return false;
+            out = parse_date(field);
+            return true;
+        }
+
+        bool parse_coordinate(double& out, std::string_view raw)
+        {
+            const std::string_view field = unquote(raw);
+            out = std::numeric_limits<double>::quiet_NaN();
+            if (field.empty()) return true;
+
+            double value = 0.0;
+            auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+            if (result.ec != std::errc{} || result.ptr != field.data() + field.size()) return false;
+            out = value;
+            return true;
+        }
+
+        // Borough names in their NYC borough code order; some extracts carry
+        // the code itself
+        bool parse_borough(uint8_t& out, std::string_view raw)
+        {
+            static constexpr std::string_view names[] = {
+                "MANHATTAN", "BRONX", "BROOKLYN", "QUEENS", "STATEN ISLAND"
+            };
 
-        split_csv_line(line, fields);
+            const std::string_view field = unquote(raw);
+            if (field.empty()) return true;
+            for (std::size_t i = 0; i < std::size(names); ++i) {
+                if (field == names[i]) {
+                    out = static_cast<uint8_t>(i + 1);
+                    return true;
+                }
+            }
 
-        DobJobApplication r{};
+            uint8_t code = 0;
+            if (!parse_integer(field, code) || code < 1 || code > std::size(names)) return false;
+            out = code;
+            return true;
+        }
 
-        size_t i = 0;
+        bool parse_building_class(char (&out)[4], std::string_view raw)
+        {
+            const std::string_view field = unquote(raw);
+            if (field.size() > sizeof(out)) return false;
+            std::memcpy(out, field.data(), field.size());
+            return true;
+        }
 
-        r.job_number = parse_simple<int32_t>(fields[i++]);
-        r.doc_number = parse_simple<int16_t>(fields[i++]);
-        r.borough    = (uint8_t)parse_simple<int32_t>(fields[i++]);
+        // Fill one field from its raw column text; the codec is fixed per
+        // field at compile time, so each call below compiles to straight-line
+        // code for that field's type
+        template <typename Record, typename Field>
+        bool parse_field(Record& r, const Field& f, std::string_view raw, Arena* arena)
+        {
+            auto& member = r.*(f.member);
+            if constexpr (Field::codec == FieldCodec::TEXT) {
+                return parse_text(member, raw, arena);
+            } else if constexpr (Field::codec == FieldCodec::INTEGER) {
+                return parse_int(member, raw);
+            } else if constexpr (Field::codec == FieldCodec::MONEY) {
+                return parse_money(member, raw);
+            } else if constexpr (Field::codec == FieldCodec::COORDINATE) {
+                return parse_coordinate(member, raw);
+            } else if constexpr (Field::codec == FieldCodec::DATE) {
+                return parse_date_field(member, raw);
+            } else if constexpr (Field::codec == FieldCodec::BOROUGH) {
+                return parse_borough(member, raw);
+            } else if constexpr (Field::codec == FieldCodec::BUILDING_CLASS) {
+                return parse_building_class(member, raw);
+            } else {
+                static_assert(Field::codec == FieldCodec::FLAG);
+                if (parse_flag(raw)) {
+                    member = DobJobApplication::Flags::from_value(
+                        static_cast<uint8_t>(member.value() | (1u << f.bit)));
+                }
+                return true;
+            }
+        }
 
-        r.house_number.assign(fields[i++]);
-        r.street_name.assign(fields[i++]);
+        template <typename Record>
+        constexpr int max_field_column()
+        {
+            return std::apply([](const auto&... f) {
+                int max = -1;
+                ((max = f.csv_index > max ? f.csv_index : max), ...);
+                return max;
+            }, RECORD_FIELDS<Record>);
+        }
 
-        r.block = parse_simple<int32_t>(fields[i++]);
-        r.lot   = parse_simple<int16_t>(fields[i++]);
-        r.bin   = parse_simple<int32_t>(fields[i++]);
+        template <typename Record>
+        Record parse_record(std::string_view line, std::vector<FieldError>* errors, Arena* arena)
+        {
+            constexpr int max_column = max_field_column<Record>();
 
-        // Continue mapping remaining columns sequentially…
-        // (You will paste the rest of the mapping here based on column order)
+            static thread_local std::vector<std::string_view> fields;
+            split_csv_line(line, fields, static_cast<std::size_t>(max_column) + 1);
 
-        if (fields.size() > 86) {
-            r.latitude = std::numeric_limits<double>::quiet_NaN();
-            std::from_chars(fields[85].data(),
-                            fields[85].data()+fields[85].size(),
-                            r.latitude);
+            if (errors) {
+                errors->clear();
+            }
 
-            r.longitude = std::numeric_limits<double>::quiet_NaN();
-            std::from_chars(fields[86].data(),
-                            fields[86].data()+fields[86].size(),
-                            r.longitude);
+            Record r{};
+            const auto parse_column = [&](const auto& f) {
+                if (f.csv_index >= static_cast<int>(fields.size())) {
+                    if (errors) {
+                        errors->push_back({f.name, f.csv_index, ParseErrorKind::MissingColumn});
+                    }
+                    return;
+                }
+                if (!parse_field(r, f, fields[static_cast<std::size_t>(f.csv_index)], arena) && errors) {
+                    errors->push_back({f.name, f.csv_index, ParseErrorKind::Malformed});
+                }
+            };
+            std::apply([&](const auto&... f) { (parse_column(f), ...); }, RECORD_FIELDS<Record>);
+            return r;
         }
+    }
+
+    DobJobApplication parse_row(std::string_view line)
+    {
+        return parse_record<DobJobApplication>(line, nullptr, nullptr);
+    }
+
+    DobJobApplication parse_row(std::string_view line, std::vector<FieldError>& errors)
+    {
+        return parse_record<DobJobApplication>(line, &errors, nullptr);
+    }
 
-        return r;
+    DobJobApplicationView parse_row_view(std::string_view line, Arena& arena)
+    {
+        return parse_record<DobJobApplicationView>(line, nullptr, &arena);
+    }
+
+    DobJobApplicationView parse_row_view(std::string_view line, Arena& arena,
+                                         std::vector<FieldError>& errors)
+    {
+        return parse_record<DobJobApplicationView>(line, &errors, &arena);
     }
 
 }
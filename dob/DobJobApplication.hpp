@@ -7,6 +7,7 @@
 #include <functional>
 #include <type_traits>
 #include <cstddef>
+#include <vector>
 #include "DobTypes.hpp"
 
 namespace dob {
@@ -109,6 +110,31 @@ struct DobJobApplication {
         uint8_t fuel_burning : 1;
         uint8_t curb_cut : 1;
 
+        // Bit i is the i-th flag above, residential first
+        uint8_t value() const {
+            return static_cast<uint8_t>((residential ? 1u : 0u)
+                | (plumbing ? 2u : 0u)
+                | (sprinkler ? 4u : 0u)
+                | (fire_alarm ? 8u : 0u)
+                | (mechanical ? 16u : 0u)
+                | (boiler ? 32u : 0u)
+                | (fuel_burning ? 64u : 0u)
+                | (curb_cut ? 128u : 0u));
+        }
+
+        static Flags from_value(uint8_t bits) {
+            Flags f{};
+            f.residential = (bits & 1u) != 0;
+            f.plumbing = ((bits >> 1) & 1u) != 0;
+            f.sprinkler = ((bits >> 2) & 1u) != 0;
+            f.fire_alarm = ((bits >> 3) & 1u) != 0;
+            f.mechanical = ((bits >> 4) & 1u) != 0;
+            f.boiler = ((bits >> 5) & 1u) != 0;
+            f.fuel_burning = ((bits >> 6) & 1u) != 0;
+            f.curb_cut = ((bits >> 7) & 1u) != 0;
+            return f;
+        }
+
         auto operator<=>(const Flags&) const = default;
         bool operator==(const Flags&) const = default;
     } flags{};
@@ -123,14 +149,7 @@ struct DobJobApplication {
     }
 
     uint8_t flags_value() const {
-        return static_cast<uint8_t>((flags.residential ? 1u : 0u)
-            | (flags.plumbing ? 2u : 0u)
-            | (flags.sprinkler ? 4u : 0u)
-            | (flags.fire_alarm ? 8u : 0u)
-            | (flags.mechanical ? 16u : 0u)
-            | (flags.boiler ? 32u : 0u)
-            | (flags.fuel_burning ? 64u : 0u)
-            | (flags.curb_cut ? 128u : 0u));
+        return flags.value();
     }
 };
 
@@ -226,6 +245,24 @@ struct hash<dob::DobJobApplication> {
 
 namespace dob {
 
+enum class ParseErrorKind : uint8_t {
+    MissingColumn,  // the row ends before the field's column
+    Malformed,      // the text does not parse as the field's type
+};
+
+// A field parse_row could not fill
+struct FieldError {
+    std::string_view field;     // COLUMN_SCHEMA name
+    int column = 0;
+    ParseErrorKind kind = ParseErrorKind::Malformed;
+};
+
+// Parse every COLUMN_SCHEMA field of a CSV row. Text is unquoted and
+// doubled quotes are collapsed; numbers, dates and money go through the
+// DobParseUtils helpers. A missing or malformed field keeps its default
+// value (latitude/longitude: NaN when present but empty or malformed) and
+// is appended to errors, which is cleared first. Never throws.
 DobJobApplication parse_row(std::string_view line);
+DobJobApplication parse_row(std::string_view line, std::vector<FieldError>& errors);
 
 }
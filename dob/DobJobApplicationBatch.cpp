@@ -0,0 +1,203 @@
+#include "DobJobApplicationBatch.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+namespace dob {
+
+    namespace {
+        using TextRef = DobJobApplicationBatch::TextRef;
+
+        template <typename Column>
+        constexpr bool is_text_column = std::is_same_v<std::remove_cvref_t<Column>, std::vector<TextRef>>;
+
+        // Call fn(column, member) for every field stored one-to-one, pairing
+        // each column of batch with the same-named member of record (a
+        // DobJobApplication, a DobJobApplicationView or another batch).
+        // building_class and flags are handled by the callers.
+        template <typename Batch, typename Record, typename Fn>
+        void for_each_field(Batch& batch, Record& record, Fn&& fn)
+        {
+            fn(batch.job_number, record.job_number);
+            fn(batch.doc_number, record.doc_number);
+            fn(batch.borough, record.borough);
+            fn(batch.bin, record.bin);
+            fn(batch.house_number, record.house_number);
+            fn(batch.street_name, record.street_name);
+            fn(batch.block, record.block);
+            fn(batch.lot, record.lot);
+            fn(batch.city, record.city);
+            fn(batch.state, record.state);
+            fn(batch.zip, record.zip);
+            fn(batch.community_board, record.community_board);
+            fn(batch.council_district, record.council_district);
+            fn(batch.census_tract, record.census_tract);
+            fn(batch.nta_name, record.nta_name);
+            fn(batch.latitude, record.latitude);
+            fn(batch.longitude, record.longitude);
+            fn(batch.job_type, record.job_type);
+            fn(batch.job_status, record.job_status);
+            fn(batch.building_type, record.building_type);
+            fn(batch.work_type, record.work_type);
+            fn(batch.permit_type, record.permit_type);
+            fn(batch.filing_status, record.filing_status);
+            fn(batch.filing_date, record.filing_date);
+            fn(batch.issuance_date, record.issuance_date);
+            fn(batch.expiration_date, record.expiration_date);
+            fn(batch.latest_action_date, record.latest_action_date);
+            fn(batch.special_action_date, record.special_action_date);
+            fn(batch.signoff_date, record.signoff_date);
+            fn(batch.owner_type, record.owner_type);
+            fn(batch.owner_name, record.owner_name);
+            fn(batch.owner_business_name, record.owner_business_name);
+            fn(batch.owner_house_number, record.owner_house_number);
+            fn(batch.owner_street_name, record.owner_street_name);
+            fn(batch.owner_city, record.owner_city);
+            fn(batch.owner_state, record.owner_state);
+            fn(batch.owner_zip, record.owner_zip);
+            fn(batch.owner_phone, record.owner_phone);
+            fn(batch.applicant_first_name, record.applicant_first_name);
+            fn(batch.applicant_last_name, record.applicant_last_name);
+            fn(batch.applicant_business_name, record.applicant_business_name);
+            fn(batch.applicant_professional_title, record.applicant_professional_title);
+            fn(batch.applicant_license, record.applicant_license);
+            fn(batch.applicant_professional_cert, record.applicant_professional_cert);
+            fn(batch.applicant_business_phone, record.applicant_business_phone);
+            fn(batch.existing_dwelling_units, record.existing_dwelling_units);
+            fn(batch.proposed_dwelling_units, record.proposed_dwelling_units);
+            fn(batch.existing_stories, record.existing_stories);
+            fn(batch.proposed_stories, record.proposed_stories);
+            fn(batch.existing_height, record.existing_height);
+            fn(batch.proposed_height, record.proposed_height);
+            fn(batch.initial_cost_cents, record.initial_cost_cents);
+            fn(batch.total_est_fee_cents, record.total_est_fee_cents);
+            fn(batch.paid_fee_cents, record.paid_fee_cents);
+            fn(batch.zoning_district_1, record.zoning_district_1);
+            fn(batch.zoning_district_2, record.zoning_district_2);
+            fn(batch.zoning_district_3, record.zoning_district_3);
+            fn(batch.zoning_district_4, record.zoning_district_4);
+            fn(batch.zoning_district_5, record.zoning_district_5);
+            fn(batch.special_district_1, record.special_district_1);
+            fn(batch.special_district_2, record.special_district_2);
+            fn(batch.job_no_good_count, record.job_no_good_count);
+        }
+
+        // Call fn(column) for every column of batch
+        template <typename Batch, typename Fn>
+        void for_each_column(Batch& batch, Fn&& fn)
+        {
+            for_each_field(batch, batch, [&](auto& column, auto&) { fn(column); });
+            fn(batch.building_class);
+            fn(batch.flags);
+        }
+    }
+
+    TextRef DobJobApplicationBatch::store(std::string_view text)
+    {
+        const TextRef ref{heap_.size(), static_cast<uint32_t>(text.size())};
+        heap_.insert(heap_.end(), text.begin(), text.end());
+        return ref;
+    }
+
+    template <typename Record>
+    void DobJobApplicationBatch::push_record(const Record& app)
+    {
+        for_each_field(*this, app, [&](auto& column, const auto& value) {
+            if constexpr (is_text_column<decltype(column)>) {
+                column.push_back(store(value));
+            } else {
+                column.push_back(value);
+            }
+        });
+
+        std::array<char, 4> cls;
+        std::memcpy(cls.data(), app.building_class, cls.size());
+        building_class.push_back(cls);
+        flags.push_back(app.flags.value());
+    }
+
+    void DobJobApplicationBatch::push_back(const DobJobApplication& app)
+    {
+        push_record(app);
+    }
+
+    void DobJobApplicationBatch::push_back(const DobJobApplicationView& app)
+    {
+        push_record(app);
+    }
+
+    DobJobApplication DobJobApplicationBatch::row(std::size_t i) const
+    {
+        DobJobApplication r{};
+        for_each_field(*this, r, [&](const auto& column, auto& member) {
+            if constexpr (is_text_column<decltype(column)>) {
+                member.assign(text(column[i]));
+            } else {
+                member = column[i];
+            }
+        });
+
+        std::memcpy(r.building_class, building_class[i].data(), sizeof(r.building_class));
+        r.flags = DobJobApplication::Flags::from_value(flags[i]);
+        return r;
+    }
+
+    DobJobApplicationBatch DobJobApplicationBatch::from_rows(const std::vector<DobJobApplication>& apps)
+    {
+        DobJobApplicationBatch batch;
+        batch.reserve(apps.size());
+        for (const auto& app : apps) {
+            batch.push_back(app);
+        }
+        return batch;
+    }
+
+    std::vector<DobJobApplication> DobJobApplicationBatch::to_rows() const
+    {
+        std::vector<DobJobApplication> rows;
+        rows.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) {
+            rows.push_back(row(i));
+        }
+        return rows;
+    }
+
+    void DobJobApplicationBatch::append(DobJobApplicationBatch&& other)
+    {
+        if (empty()) {
+            *this = std::move(other);
+            other.clear();
+            return;
+        }
+
+        // other's text lands after ours, so its references shift by our heap size
+        const uint64_t base = heap_.size();
+        heap_.insert(heap_.end(), other.heap_.begin(), other.heap_.end());
+
+        for_each_field(*this, other, [&](auto& column, auto& source) {
+            const std::size_t first = column.size();
+            column.insert(column.end(), source.begin(), source.end());
+            if constexpr (is_text_column<decltype(column)>) {
+                for (std::size_t k = first; k < column.size(); ++k) {
+                    column[k].offset += base;
+                }
+            }
+        });
+        building_class.insert(building_class.end(), other.building_class.begin(), other.building_class.end());
+        flags.insert(flags.end(), other.flags.begin(), other.flags.end());
+
+        other.clear();
+    }
+
+    void DobJobApplicationBatch::reserve(std::size_t rows)
+    {
+        for_each_column(*this, [&](auto& column) { column.reserve(rows); });
+    }
+
+    void DobJobApplicationBatch::clear()
+    {
+        for_each_column(*this, [](auto& column) { column.clear(); });
+        heap_.clear();
+    }
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "DobJobApplication.hpp"
+#include "DobJobApplicationView.hpp"
+
+namespace dob {
+
+// Struct-of-arrays form of a run of DobJobApplication records: one
+// contiguous vector per field, indexed by position in the batch. Analytics
+// over one or two fields (say, summing initial_cost_cents) become a linear
+// scan over a single array. Text fields are references into one byte heap
+// shared by every text column of the batch.
+class DobJobApplicationBatch {
+public:
+    // size bytes at offset in the batch's text heap
+    struct TextRef {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // Core identifiers
+    std::vector<int32_t> job_number;
+    std::vector<int16_t> doc_number;
+    std::vector<uint8_t> borough;
+    std::vector<int32_t> bin;
+
+    // Location
+    std::vector<TextRef> house_number;
+    std::vector<TextRef> street_name;
+    std::vector<int32_t> block;
+    std::vector<int16_t> lot;
+
+    std::vector<TextRef> city;
+    std::vector<TextRef> state;
+    std::vector<TextRef> zip;
+
+    std::vector<int16_t> community_board;
+    std::vector<int16_t> council_district;
+    std::vector<int32_t> census_tract;
+    std::vector<TextRef> nta_name;
+
+    std::vector<double> latitude;
+    std::vector<double> longitude;
+
+    // Job classification
+    std::vector<TextRef> job_type;
+    std::vector<TextRef> job_status;
+    std::vector<TextRef> building_type;
+    std::vector<std::array<char, 4>> building_class;
+
+    std::vector<TextRef> work_type;
+    std::vector<TextRef> permit_type;
+    std::vector<TextRef> filing_status;
+
+    // Dates
+    std::vector<Date> filing_date;
+    std::vector<Date> issuance_date;
+    std::vector<Date> expiration_date;
+    std::vector<Date> latest_action_date;
+    std::vector<Date> special_action_date;
+    std::vector<Date> signoff_date;
+
+    // Owner info
+    std::vector<TextRef> owner_type;
+    std::vector<TextRef> owner_name;
+    std::vector<TextRef> owner_business_name;
+    std::vector<TextRef> owner_house_number;
+    std::vector<TextRef> owner_street_name;
+    std::vector<TextRef> owner_city;
+    std::vector<TextRef> owner_state;
+    std::vector<TextRef> owner_zip;
+    std::vector<TextRef> owner_phone;
+
+    // Applicant info
+    std::vector<TextRef> applicant_first_name;
+    std::vector<TextRef> applicant_last_name;
+    std::vector<TextRef> applicant_business_name;
+    std::vector<TextRef> applicant_professional_title;
+    std::vector<TextRef> applicant_license;
+    std::vector<TextRef> applicant_professional_cert;
+    std::vector<TextRef> applicant_business_phone;
+
+    // Dimensions / units
+    std::vector<int16_t> existing_dwelling_units;
+    std::vector<int16_t> proposed_dwelling_units;
+    std::vector<int16_t> existing_stories;
+    std::vector<int16_t> proposed_stories;
+    std::vector<int32_t> existing_height;
+    std::vector<int32_t> proposed_height;
+
+    // Financial
+    std::vector<int64_t> initial_cost_cents;
+    std::vector<int64_t> total_est_fee_cents;
+    std::vector<int64_t> paid_fee_cents;
+
+    // Zoning
+    std::vector<TextRef> zoning_district_1;
+    std::vector<TextRef> zoning_district_2;
+    std::vector<TextRef> zoning_district_3;
+    std::vector<TextRef> zoning_district_4;
+    std::vector<TextRef> zoning_district_5;
+
+    std::vector<TextRef> special_district_1;
+    std::vector<TextRef> special_district_2;
+
+    std::vector<uint8_t> flags;     // DobJobApplication::Flags::value()
+    std::vector<uint8_t> job_no_good_count;
+
+    std::size_t size() const { return job_number.size(); }
+    bool empty() const { return job_number.empty(); }
+
+    std::string_view text(TextRef ref) const {
+        return {heap_.data() + ref.offset, ref.size};
+    }
+
+    // Append one record; its text is copied into the heap
+    void push_back(const DobJobApplication& app);
+    void push_back(const DobJobApplicationView& app);
+
+    // Record i as the owning struct
+    DobJobApplication row(std::size_t i) const;
+
+    static DobJobApplicationBatch from_rows(const std::vector<DobJobApplication>& apps);
+    std::vector<DobJobApplication> to_rows() const;
+
+    // Move other's rows to the end of this batch
+    void append(DobJobApplicationBatch&& other);
+
+    void reserve(std::size_t rows);
+    void clear();
+
+    std::size_t heap_bytes() const { return heap_.size(); }
+
+private:
+    std::vector<char> heap_;
+
+    TextRef store(std::string_view text);
+
+    template <typename Record>
+    void push_record(const Record& app);
+};
+
+}
@@ -0,0 +1,108 @@
+#include "DobJobApplicationView.hpp"
+
+#include <cstring>
+#include <iterator>
+
+namespace dob {
+
+    DobJobApplication DobJobApplicationView::to_owned() const
+    {
+        DobJobApplication r{};
+
+        r.job_number = job_number;
+        r.doc_number = doc_number;
+        r.borough = borough;
+        r.bin = bin;
+        r.block = block;
+        r.lot = lot;
+        r.community_board = community_board;
+        r.council_district = council_district;
+        r.census_tract = census_tract;
+        r.latitude = latitude;
+        r.longitude = longitude;
+        r.filing_date = filing_date;
+        r.issuance_date = issuance_date;
+        r.expiration_date = expiration_date;
+        r.latest_action_date = latest_action_date;
+        r.special_action_date = special_action_date;
+        r.signoff_date = signoff_date;
+        r.existing_dwelling_units = existing_dwelling_units;
+        r.proposed_dwelling_units = proposed_dwelling_units;
+        r.existing_stories = existing_stories;
+        r.proposed_stories = proposed_stories;
+        r.existing_height = existing_height;
+        r.proposed_height = proposed_height;
+        r.initial_cost_cents = initial_cost_cents;
+        r.total_est_fee_cents = total_est_fee_cents;
+        r.paid_fee_cents = paid_fee_cents;
+        std::memcpy(r.building_class, building_class, sizeof(building_class));
+        r.flags = flags;
+        r.job_no_good_count = job_no_good_count;
+
+        r.house_number.assign(house_number);
+        r.street_name.assign(street_name);
+        r.city.assign(city);
+        r.state.assign(state);
+        r.zip.assign(zip);
+        r.nta_name.assign(nta_name);
+        r.job_type.assign(job_type);
+        r.job_status.assign(job_status);
+        r.building_type.assign(building_type);
+        r.work_type.assign(work_type);
+        r.permit_type.assign(permit_type);
+        r.filing_status.assign(filing_status);
+        r.owner_type.assign(owner_type);
+        r.owner_name.assign(owner_name);
+        r.owner_business_name.assign(owner_business_name);
+        r.owner_house_number.assign(owner_house_number);
+        r.owner_street_name.assign(owner_street_name);
+        r.owner_city.assign(owner_city);
+        r.owner_state.assign(owner_state);
+        r.owner_zip.assign(owner_zip);
+        r.owner_phone.assign(owner_phone);
+        r.applicant_first_name.assign(applicant_first_name);
+        r.applicant_last_name.assign(applicant_last_name);
+        r.applicant_business_name.assign(applicant_business_name);
+        r.applicant_professional_title.assign(applicant_professional_title);
+        r.applicant_license.assign(applicant_license);
+        r.applicant_professional_cert.assign(applicant_professional_cert);
+        r.applicant_business_phone.assign(applicant_business_phone);
+        r.zoning_district_1.assign(zoning_district_1);
+        r.zoning_district_2.assign(zoning_district_2);
+        r.zoning_district_3.assign(zoning_district_3);
+        r.zoning_district_4.assign(zoning_district_4);
+        r.zoning_district_5.assign(zoning_district_5);
+        r.special_district_1.assign(special_district_1);
+        r.special_district_2.assign(special_district_2);
+
+        return r;
+    }
+
+    void DobJobApplicationViews::append(std::string_view line, bool stable)
+    {
+        if (!stable) {
+            line = arena_.copy(line);
+        }
+        rows_.push_back(parse_row_view(line, arena_));
+    }
+
+    void DobJobApplicationViews::append(DobJobApplicationViews&& other)
+    {
+        if (rows_.empty()) {
+            rows_ = std::move(other.rows_);
+        } else {
+            rows_.insert(rows_.end(),
+                         std::make_move_iterator(other.rows_.begin()),
+                         std::make_move_iterator(other.rows_.end()));
+        }
+        arena_.adopt(std::move(other.arena_));
+        other.rows_.clear();
+    }
+
+    void DobJobApplicationViews::clear()
+    {
+        rows_.clear();
+        arena_.clear();
+    }
+
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "DobArena.hpp"
+#include "DobJobApplication.hpp"
+
+namespace dob {
+
+// DobJobApplication with every text field as a view. The views point into
+// the row text the record was parsed from, so a view is only as long-lived
+// as that text: the mapped CSV or the arena of a DobJobApplicationViews.
+struct DobJobApplicationView {
+
+    // Core identifiers
+    int32_t job_number{};
+    int16_t doc_number{};
+    uint8_t borough{};
+    int32_t bin{};
+
+    // Location
+    std::string_view house_number;
+    std::string_view street_name;
+    int32_t block{};
+    int16_t lot{};
+
+    std::string_view city;
+    std::string_view state;
+    std::string_view zip;
+
+    int16_t community_board{};
+    int16_t council_district{};
+    int32_t census_tract{};
+    std::string_view nta_name;
+
+    double latitude{};
+    double longitude{};
+
+    // Job classification
+    std::string_view job_type;
+    std::string_view job_status;
+    std::string_view building_type;
+    char building_class[4]{};
+
+    std::string_view work_type;
+    std::string_view permit_type;
+    std::string_view filing_status;
+
+    // Dates
+    Date filing_date{};
+    Date issuance_date{};
+    Date expiration_date{};
+    Date latest_action_date{};
+    Date special_action_date{};
+    Date signoff_date{};
+
+    // Owner info
+    std::string_view owner_type;
+    std::string_view owner_name;
+    std::string_view owner_business_name;
+    std::string_view owner_house_number;
+    std::string_view owner_street_name;
+    std::string_view owner_city;
+    std::string_view owner_state;
+    std::string_view owner_zip;
+    std::string_view owner_phone;
+
+    // Applicant info
+    std::string_view applicant_first_name;
+    std::string_view applicant_last_name;
+    std::string_view applicant_business_name;
+    std::string_view applicant_professional_title;
+    std::string_view applicant_license;
+    std::string_view applicant_professional_cert;
+    std::string_view applicant_business_phone;
+
+    // Dimensions / units
+    int16_t existing_dwelling_units{};
+    int16_t proposed_dwelling_units{};
+    int16_t existing_stories{};
+    int16_t proposed_stories{};
+    int32_t existing_height{};
+    int32_t proposed_height{};
+
+    // Financial
+    int64_t initial_cost_cents{};
+    int64_t total_est_fee_cents{};
+    int64_t paid_fee_cents{};
+
+    // Zoning
+    std::string_view zoning_district_1;
+    std::string_view zoning_district_2;
+    std::string_view zoning_district_3;
+    std::string_view zoning_district_4;
+    std::string_view zoning_district_5;
+
+    std::string_view special_district_1;
+    std::string_view special_district_2;
+
+    DobJobApplication::Flags flags{};
+
+    uint8_t job_no_good_count{};
+
+    // Owning copy of the record
+    DobJobApplication to_owned() const;
+};
+
+// parse_row without copying text: text fields view line, except those with
+// doubled quotes, whose unescaped text is written to arena
+DobJobApplicationView parse_row_view(std::string_view line, Arena& arena);
+DobJobApplicationView parse_row_view(std::string_view line, Arena& arena,
+                                     std::vector<FieldError>& errors);
+
+// A batch of parsed rows whose text lives either in the mapped CSV or in the
+// batch's own arena, so the whole batch is torn down with a handful of frees
+// instead of one per string field. Moving the batch keeps every view valid;
+// copying is not allowed.
+class DobJobApplicationViews {
+public:
+    DobJobApplicationViews() = default;
+    DobJobApplicationViews(DobJobApplicationViews&&) noexcept = default;
+    DobJobApplicationViews& operator=(DobJobApplicationViews&&) noexcept = default;
+    DobJobApplicationViews(const DobJobApplicationViews&) = delete;
+    DobJobApplicationViews& operator=(const DobJobApplicationViews&) = delete;
+
+    // Parse line and append it. A line that outlives the batch (e.g. a view
+    // of the mapped CSV) is referenced in place; otherwise it is first copied
+    // into the arena.
+    void append(std::string_view line, bool stable);
+
+    // Move other's rows and arena to the end of this batch
+    void append(DobJobApplicationViews&& other);
+
+    void reserve(std::size_t n) { rows_.reserve(n); }
+    void clear();
+
+    std::size_t size() const { return rows_.size(); }
+    bool empty() const { return rows_.empty(); }
+    const DobJobApplicationView& operator[](std::size_t i) const { return rows_[i]; }
+
+    auto begin() const { return rows_.begin(); }
+    auto end() const { return rows_.end(); }
+
+    const Arena& arena() const { return arena_; }
+
+private:
+    std::vector<DobJobApplicationView> rows_;
+    Arena arena_;
+};
+
+}
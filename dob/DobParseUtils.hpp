@@ -1,131 +1,50 @@
 #pragma once
 
+#include <cstddef>
+#include <string>
 #include <string_view>
 #include <charconv>
 #include <cstdint>
-#include <unordered_map>
 #include <utility>
 #include <optional>
+#include <system_error>
 
+#include "DobSchema.hpp"
 #include "DobTypes.hpp"
 
 namespace dob {
 
-    // Column category for query evaluation
-    enum class ColumnCategory { STRING, BOOLEAN, NUMERIC };
-
-    // Column info map: object field name -> (csv index, category)
-    // Types are based on DobJobApplication struct field types and actual CSV data
-    inline const std::unordered_map<std::string_view, std::pair<int, ColumnCategory>> COLUMN_INFO_MAP = {
-        // Core identifiers (all NUMERIC in struct)
-        {"job_number", {0, ColumnCategory::NUMERIC}},              // Job # (int32_t) - CSV: "321386512" (numeric string)
-        {"doc_number", {1, ColumnCategory::NUMERIC}},              // Doc # (int16_t)
-        {"borough", {2, ColumnCategory::STRING}},                  // Borough (STRING - CSV: "BROOKLYN", "QUEENS", "BRONX")
-        {"bin", {7, ColumnCategory::NUMERIC}},                     // Bin # (int32_t)
-
-        // Location
-        {"house_number", {3, ColumnCategory::STRING}},             // House # (std::string)
-        {"street_name", {4, ColumnCategory::STRING}},              // Street Name (std::string)
-        {"block", {5, ColumnCategory::NUMERIC}},                   // Block (int32_t)
-        {"lot", {6, ColumnCategory::NUMERIC}},                     // Lot (int16_t)
-        {"city", {76, ColumnCategory::STRING}},                    // City (std::string)
-        {"state", {77, ColumnCategory::STRING}},                   // State (std::string)
-        {"zip", {78, ColumnCategory::STRING}},                     // Zip (std::string)
-        {"community_board", {13, ColumnCategory::NUMERIC}},        // Community - Board (int16_t)
-        {"council_district", {92, ColumnCategory::NUMERIC}},       // GIS_COUNCIL_DISTRICT (int16_t, see struct)
-        {"census_tract", {93, ColumnCategory::NUMERIC}},           // GIS_CENSUS_TRACT (int32_t, see struct)
-        {"nta_name", {94, ColumnCategory::STRING}},                // GIS_NTA_NAME (std::string)
-        {"latitude", {90, ColumnCategory::NUMERIC}},               // GIS_LATITUDE (double)
-        {"longitude", {91, ColumnCategory::NUMERIC}},              // GIS_LONGITUDE (double)
-
-        // Job classification
-        {"job_type", {8, ColumnCategory::STRING}},                 // Job Type (std::string)
-        {"job_status", {9, ColumnCategory::STRING}},               // Job Status (std::string)
-        {"building_type", {12, ColumnCategory::STRING}},           // Building Type (std::string)
-        {"building_class", {88, ColumnCategory::STRING}},          // BUILDING_CLASS (char[4])
-        {"work_type", {80, ColumnCategory::STRING}},               // Job Description (std::string)
-        {"permit_type", {21, ColumnCategory::STRING}},             // eFiling Filed (std::string)
-        {"filing_status", {48, ColumnCategory::STRING}},           // Fee Status (std::string)
-
-        // Dates (all NUMERIC - stored as Date type which is numeric)
-        {"filing_date", {40, ColumnCategory::NUMERIC}},            // Pre- Filing Date (Date)
-        {"issuance_date", {44, ColumnCategory::NUMERIC}},          // Approved (Date)
-        {"expiration_date", {45, ColumnCategory::NUMERIC}},        // Fully Permitted (Date)
-        {"latest_action_date", {11, ColumnCategory::NUMERIC}},     // Latest Action Date (Date)
-        {"special_action_date", {87, ColumnCategory::NUMERIC}},    // SPECIAL_ACTION_DATE (Date)
-        {"signoff_date", {85, ColumnCategory::NUMERIC}},           // SIGNOFF_DATE (Date)
-
-        // Owner info (all STRING except maybe some)
-        {"owner_type", {69, ColumnCategory::STRING}},              // Owner Type (std::string)
-        {"owner_name", {71, ColumnCategory::STRING}},              // Owner's First Name (std::string - combined)
-        {"owner_business_name", {73, ColumnCategory::STRING}},     // Owner's Business Name (std::string)
-        {"owner_house_number", {74, ColumnCategory::STRING}},      // Owner's House Number (std::string)
-        {"owner_street_name", {75, ColumnCategory::STRING}},       // Owner'sHouse Street Name (std::string)
-        {"owner_city", {76, ColumnCategory::STRING}},              // City (std::string, shared)
-        {"owner_state", {77, ColumnCategory::STRING}},             // State (std::string, shared)
-        {"owner_zip", {78, ColumnCategory::STRING}},               // Zip (std::string, shared)
-        {"owner_phone", {79, ColumnCategory::STRING}},             // Owner'sPhone # (std::string)
-
-        // Applicant info (all STRING)
-        {"applicant_first_name", {35, ColumnCategory::STRING}},    // Applicant's First Name (std::string)
-        {"applicant_last_name", {36, ColumnCategory::STRING}},     // Applicant's Last Name (std::string)
-        {"applicant_professional_title", {37, ColumnCategory::STRING}}, // Applicant Professional Title (std::string)
-        {"applicant_license", {38, ColumnCategory::STRING}},       // Applicant License # (std::string)
-        {"applicant_professional_cert", {39, ColumnCategory::STRING}}, // Professional Cert (std::string)
-        {"applicant_business_name", {39, ColumnCategory::STRING}}, // Professional Cert (std::string - mapped, check if needed)
-
-        // Dimensions / units (all NUMERIC - stored as int16_t or int32_t)
-        {"existing_dwelling_units", {59, ColumnCategory::NUMERIC}},    // Existing Dwelling Units (int16_t)
-        {"proposed_dwelling_units", {60, ColumnCategory::NUMERIC}},    // Proposed Dwelling Units (int16_t)
-        {"existing_stories", {55, ColumnCategory::NUMERIC}},           // ExistingNo. of Stories (int16_t)
-        {"proposed_stories", {56, ColumnCategory::NUMERIC}},           // Proposed No. of Stories (int16_t)
-        {"existing_height", {57, ColumnCategory::NUMERIC}},            // Existing Height (int32_t)
-        {"proposed_height", {58, ColumnCategory::NUMERIC}},            // Proposed Height (int32_t)
-
-        // Financial (all NUMERIC - stored as int64_t in cents)
-        {"initial_cost_cents", {46, ColumnCategory::NUMERIC}},     // Initial Cost (int64_t)
-        {"total_est_fee_cents", {47, ColumnCategory::NUMERIC}},    // Total Est. Fee (int64_t)
-        {"paid_fee_cents", {41, ColumnCategory::NUMERIC}},         // Paid (int64_t)
-
-        // Zoning (all STRING)
-        {"zoning_district_1", {64, ColumnCategory::STRING}},       // Zoning Dist1 (std::string)
-        {"zoning_district_2", {65, ColumnCategory::STRING}},       // Zoning Dist2 (std::string)
-        {"zoning_district_3", {66, ColumnCategory::STRING}},       // Zoning Dist3 (std::string)
-        {"zoning_district_4", {67, ColumnCategory::STRING}},       // Special District 1 (std::string)
-        {"zoning_district_5", {68, ColumnCategory::STRING}},       // Special District 2 (std::string)
-        {"special_district_1", {67, ColumnCategory::STRING}},      // Special District 1 (std::string)
-        {"special_district_2", {68, ColumnCategory::STRING}},      // Special District 2 (std::string)
-
-        // Flags (all BOOLEAN - struct Flags with bit fields)
-        {"residential", {15, ColumnCategory::BOOLEAN}},            // Landmarked (uint8_t:1)
-        {"plumbing", {22, ColumnCategory::BOOLEAN}},               // Plumbing (uint8_t:1)
-        {"sprinkler", {28, ColumnCategory::BOOLEAN}},              // Sprinkler (uint8_t:1)
-        {"fire_alarm", {29, ColumnCategory::BOOLEAN}},             // Fire Alarm (uint8_t:1)
-        {"mechanical", {23, ColumnCategory::BOOLEAN}},             // Mechanical (uint8_t:1)
-        {"boiler", {24, ColumnCategory::BOOLEAN}},                 // Boiler (uint8_t:1)
-        {"fuel_burning", {25, ColumnCategory::BOOLEAN}},           // Fuel Burning (uint8_t:1)
-        {"curb_cut", {32, ColumnCategory::BOOLEAN}},               // Curb Cut (uint8_t:1)
-
-        // Other numeric fields
-        {"job_no_good_count", {89, ColumnCategory::NUMERIC}},      // JOB_NO_GOOD_COUNT (uint8_t)
-    };
-
     // Get column index and category by name
-    inline std::optional<std::pair<int, ColumnCategory>> column_info(std::string_view column_name) {
-        auto it = COLUMN_INFO_MAP.find(column_name);
-        if (it != COLUMN_INFO_MAP.end()) {
-            return it->second;
+    constexpr std::optional<std::pair<int, ColumnCategory>> column_info(std::string_view column_name) {
+        if (auto column = find_column(column_name)) {
+            return std::make_pair(column->csv_index, column->category);
         }
         return std::nullopt;
     }
 
     template <typename T>
     inline T parse_simple(std::string_view s) {
-        T tmp;
+        T tmp{};
         std::from_chars(s.data(), s.data()+s.size(), tmp);
         return tmp;
     }
 
+    // Integer value of the whole of s; false (out untouched) when s is not
+    // exactly one integer that fits T
+    template <typename T>
+    inline bool parse_integer(std::string_view s, T& out) {
+        T tmp{};
+        auto result = std::from_chars(s.data(), s.data() + s.size(), tmp);
+        if (result.ec != std::errc{} || result.ptr != s.data() + s.size()) {
+            return false;
+        }
+        out = tmp;
+        return true;
+    }
+
+    // Cents of money text ([$][-]digits[,digits][.digits]). The fraction is
+    // in dollars: one digit is tens of cents, and digits past the second
+    // round to the nearest cent.
     inline int64_t parse_money_cents(std::string_view s) {
         if (s.empty()) return 0;
 
@@ -137,19 +56,55 @@ namespace dob {
 
         int64_t dollars = 0;
         int64_t cents = 0;
+        int fraction_digits = 0;
+        bool round_up = false;
         bool after_decimal = false;
 
         for (; i < s.size(); ++i) {
             char c = s[i];
             if (c == '.') { after_decimal = true; continue; }
+            if (c == ',') continue;
             if (!after_decimal) dollars = dollars*10 + (c-'0');
-            else cents = cents*10 + (c-'0');
+            else if (fraction_digits < 2) { cents = cents*10 + (c-'0'); ++fraction_digits; }
+            else if (fraction_digits++ == 2) round_up = c >= '5';
         }
+        if (fraction_digits == 1) cents *= 10;
 
-        int64_t total = dollars*100 + cents;
+        int64_t total = dollars*100 + cents + (round_up ? 1 : 0);
         return neg ? -total : total;
     }
 
+    // True for text parse_date understands: MM/DD/YYYY, optionally followed
+    // by a time of day
+    inline bool is_date(std::string_view s) {
+        if (s.size() < 10 || s[2] != '/' || s[5] != '/') return false;
+        constexpr std::size_t digits[] = {0, 1, 3, 4, 6, 7, 8, 9};
+        for (std::size_t i : digits) {
+            if (s[i] < '0' || s[i] > '9') return false;
+        }
+        return s.size() == 10 || s[10] == ' ';
+    }
+
+    // True for exact money text: [$][-]digits[,digits][.d[d]], at most two
+    // fractional digits so no sub-cent amount is silently rounded
+    inline bool is_money(std::string_view s) {
+        std::size_t i = 0;
+        if (i < s.size() && s[i] == '$') i++;
+        if (i < s.size() && s[i] == '-') i++;
+        bool digit = false;
+        bool decimal = false;
+        int fraction_digits = 0;
+        for (; i < s.size(); ++i) {
+            const char c = s[i];
+            if (c == '.' && !decimal) { decimal = true; continue; }
+            if (c == ',' && !decimal) continue;
+            if (c < '0' || c > '9') return false;
+            if (decimal && ++fraction_digits > 2) return false;
+            digit = true;
+        }
+        return digit;
+    }
+
     inline Date parse_date(std::string_view s) {
         if (s.size() < 10) return 0;
 
@@ -164,5 +119,70 @@ namespace dob {
         return yyyy*10000 + mm*100 + dd;
     }
 
+    // Strip one pair of surrounding quotes from a raw CSV field (no copy)
+    inline std::string_view unquote(std::string_view field) {
+        if (field.size() >= 2 && field.front() == '"' && field.back() == '"') {
+            field = field.substr(1, field.size() - 2);
+        }
+        return field;
+    }
+
+    // A doubled quote inside a quoted field stands for one quote character
+    inline bool has_escaped_quotes(std::string_view field) {
+        return field.find("\"\"") != std::string_view::npos;
+    }
+
+    // Copy field to dst with every doubled quote collapsed to one; dst needs
+    // room for field.size() bytes. Returns the bytes written.
+    inline std::size_t unescape_quotes(std::string_view field, char* dst) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < field.size(); ++i) {
+            dst[n++] = field[i];
+            if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"') {
+                ++i;
+            }
+        }
+        return n;
+    }
+
+    // Text of a raw field as records see it: unquoted, with doubled quotes
+    // collapsed into buffer when it has any (the result then views buffer)
+    inline std::string_view field_text(std::string_view raw, std::string& buffer) {
+        const std::string_view field = unquote(raw);
+        if (field.size() == raw.size() || !has_escaped_quotes(field)) {
+            return field;
+        }
+        buffer.resize(field.size());
+        buffer.resize(unescape_quotes(field, buffer.data()));
+        return buffer;
+    }
+
+    // Numeric value of a raw field of a CSV column as queries see it (0 when
+    // empty or malformed). Money columns read as cents, like parse_row's
+    // MONEY fields, whether or not the text has a '$'.
+    inline double parse_number(std::string_view field, int csv_index) {
+        field = unquote(field);
+        if (field.empty()) {
+            return 0.0;
+        }
+        if (is_money_column(csv_index)) {
+            return is_money(field) ? static_cast<double>(parse_money_cents(field)) : 0.0;
+        }
+
+        double val = 0.0;
+        auto result = std::from_chars(field.data(), field.data() + field.size(), val);
+        if (result.ec != std::errc{}) {
+            return 0.0;
+        }
+        return val;
+    }
+
+    // Boolean value of a raw flag field ("X", "Y", "1", "true", ...)
+    inline bool parse_flag(std::string_view field) {
+        field = unquote(field);
+        return field == "1" || field == "true" || field == "True" || field == "TRUE" ||
+               field == "X" || field == "x" || field == "Y" || field == "y";
+    }
+
 
 }
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+
+namespace dob {
+
+    // Column category for query evaluation
+    enum class ColumnCategory { STRING, BOOLEAN, NUMERIC, DATE };
+
+    // One named column of the CSV as queries see it
+    struct ColumnDescriptor {
+        std::string_view name;      // DobJobApplication field name
+        int csv_index = 0;
+        ColumnCategory category = ColumnCategory::STRING;
+        bool money = false;         // NUMERIC text in dollars, read as cents
+    };
+
+    // Every queryable column: field name -> (csv index, category).
+    // Types are based on DobJobApplication struct field types and actual CSV data
+    inline constexpr ColumnDescriptor COLUMN_SCHEMA[] = {
+        // Core identifiers (all NUMERIC in struct)
+        {"job_number", 0, ColumnCategory::NUMERIC},              // Job # (int32_t) - CSV: "321386512" (numeric string)
+        {"doc_number", 1, ColumnCategory::NUMERIC},              // Doc # (int16_t)
+        {"borough", 2, ColumnCategory::STRING},                  // Borough (STRING - CSV: "BROOKLYN", "QUEENS", "BRONX")
+        {"bin", 7, ColumnCategory::NUMERIC},                     // Bin # (int32_t)
+
+        // Location
+        {"house_number", 3, ColumnCategory::STRING},             // House # (std::string)
+        {"street_name", 4, ColumnCategory::STRING},              // Street Name (std::string)
+        {"block", 5, ColumnCategory::NUMERIC},                   // Block (int32_t)
+        {"lot", 6, ColumnCategory::NUMERIC},                     // Lot (int16_t)
+        {"city", 76, ColumnCategory::STRING},                    // City (std::string)
+        {"state", 77, ColumnCategory::STRING},                   // State (std::string)
+        {"zip", 78, ColumnCategory::STRING},                     // Zip (std::string)
+        {"community_board", 13, ColumnCategory::NUMERIC},        // Community - Board (int16_t)
+        {"council_district", 92, ColumnCategory::NUMERIC},       // GIS_COUNCIL_DISTRICT (int16_t, see struct)
+        {"census_tract", 93, ColumnCategory::NUMERIC},           // GIS_CENSUS_TRACT (int32_t, see struct)
+        {"nta_name", 94, ColumnCategory::STRING},                // GIS_NTA_NAME (std::string)
+        {"latitude", 90, ColumnCategory::NUMERIC},               // GIS_LATITUDE (double)
+        {"longitude", 91, ColumnCategory::NUMERIC},              // GIS_LONGITUDE (double)
+
+        // Job classification
+        {"job_type", 8, ColumnCategory::STRING},                 // Job Type (std::string)
+        {"job_status", 9, ColumnCategory::STRING},               // Job Status (std::string)
+        {"building_type", 12, ColumnCategory::STRING},           // Building Type (std::string)
+        {"building_class", 88, ColumnCategory::STRING},          // BUILDING_CLASS (char[4])
+        {"work_type", 80, ColumnCategory::STRING},               // Job Description (std::string)
+        {"permit_type", 21, ColumnCategory::STRING},             // eFiling Filed (std::string)
+        {"filing_status", 48, ColumnCategory::STRING},           // Fee Status (std::string)
+
+        // Dates (all DATE - MM/DD/YYYY in the CSV, compared as YYYYMMDD Date values)
+        {"filing_date", 40, ColumnCategory::DATE},               // Pre- Filing Date (Date)
+        {"issuance_date", 44, ColumnCategory::DATE},             // Approved (Date)
+        {"expiration_date", 45, ColumnCategory::DATE},           // Fully Permitted (Date)
+        {"latest_action_date", 11, ColumnCategory::DATE},        // Latest Action Date (Date)
+        {"special_action_date", 87, ColumnCategory::DATE},       // SPECIAL_ACTION_DATE (Date)
+        {"signoff_date", 85, ColumnCategory::DATE},              // SIGNOFF_DATE (Date)
+
+        // Owner info (all STRING except maybe some)
+        {"owner_type", 69, ColumnCategory::STRING},              // Owner Type (std::string)
+        {"owner_name", 71, ColumnCategory::STRING},              // Owner's First Name (std::string - combined)
+        {"owner_business_name", 73, ColumnCategory::STRING},     // Owner's Business Name (std::string)
+        {"owner_house_number", 74, ColumnCategory::STRING},      // Owner's House Number (std::string)
+        {"owner_street_name", 75, ColumnCategory::STRING},       // Owner'sHouse Street Name (std::string)
+        {"owner_city", 76, ColumnCategory::STRING},              // City (std::string, shared)
+        {"owner_state", 77, ColumnCategory::STRING},             // State (std::string, shared)
+        {"owner_zip", 78, ColumnCategory::STRING},               // Zip (std::string, shared)
+        {"owner_phone", 79, ColumnCategory::STRING},             // Owner'sPhone # (std::string)
+
+        // Applicant info (all STRING)
+        {"applicant_first_name", 35, ColumnCategory::STRING},    // Applicant's First Name (std::string)
+        {"applicant_last_name", 36, ColumnCategory::STRING},     // Applicant's Last Name (std::string)
+        {"applicant_professional_title", 37, ColumnCategory::STRING}, // Applicant Professional Title (std::string)
+        {"applicant_license", 38, ColumnCategory::STRING},       // Applicant License # (std::string)
+        {"applicant_professional_cert", 39, ColumnCategory::STRING}, // Professional Cert (std::string)
+        {"applicant_business_name", 39, ColumnCategory::STRING}, // Professional Cert (std::string - mapped, check if needed)
+
+        // Dimensions / units (all NUMERIC - stored as int16_t or int32_t)
+        {"existing_dwelling_units", 59, ColumnCategory::NUMERIC},    // Existing Dwelling Units (int16_t)
+        {"proposed_dwelling_units", 60, ColumnCategory::NUMERIC},    // Proposed Dwelling Units (int16_t)
+        {"existing_stories", 55, ColumnCategory::NUMERIC},           // ExistingNo. of Stories (int16_t)
+        {"proposed_stories", 56, ColumnCategory::NUMERIC},           // Proposed No. of Stories (int16_t)
+        {"existing_height", 57, ColumnCategory::NUMERIC},            // Existing Height (int32_t)
+        {"proposed_height", 58, ColumnCategory::NUMERIC},            // Proposed Height (int32_t)
+
+        // Financial (all NUMERIC - stored as int64_t in cents)
+        {"initial_cost_cents", 46, ColumnCategory::NUMERIC, true},   // Initial Cost (int64_t)
+        {"total_est_fee_cents", 47, ColumnCategory::NUMERIC, true},  // Total Est. Fee (int64_t)
+        {"paid_fee_cents", 41, ColumnCategory::NUMERIC, true},       // Paid (int64_t)
+
+        // Zoning (all STRING)
+        {"zoning_district_1", 64, ColumnCategory::STRING},       // Zoning Dist1 (std::string)
+        {"zoning_district_2", 65, ColumnCategory::STRING},       // Zoning Dist2 (std::string)
+        {"zoning_district_3", 66, ColumnCategory::STRING},       // Zoning Dist3 (std::string)
+        {"zoning_district_4", 67, ColumnCategory::STRING},       // Special District 1 (std::string)
+        {"zoning_district_5", 68, ColumnCategory::STRING},       // Special District 2 (std::string)
+        {"special_district_1", 67, ColumnCategory::STRING},      // Special District 1 (std::string)
+        {"special_district_2", 68, ColumnCategory::STRING},      // Special District 2 (std::string)
+
+        // Flags (all BOOLEAN - struct Flags with bit fields)
+        {"residential", 15, ColumnCategory::BOOLEAN},            // Landmarked (uint8_t:1)
+        {"plumbing", 22, ColumnCategory::BOOLEAN},               // Plumbing (uint8_t:1)
+        {"sprinkler", 28, ColumnCategory::BOOLEAN},              // Sprinkler (uint8_t:1)
+        {"fire_alarm", 29, ColumnCategory::BOOLEAN},             // Fire Alarm (uint8_t:1)
+        {"mechanical", 23, ColumnCategory::BOOLEAN},             // Mechanical (uint8_t:1)
+        {"boiler", 24, ColumnCategory::BOOLEAN},                 // Boiler (uint8_t:1)
+        {"fuel_burning", 25, ColumnCategory::BOOLEAN},           // Fuel Burning (uint8_t:1)
+        {"curb_cut", 32, ColumnCategory::BOOLEAN},               // Curb Cut (uint8_t:1)
+
+        // Other numeric fields
+        {"job_no_good_count", 89, ColumnCategory::NUMERIC},      // JOB_NO_GOOD_COUNT (uint8_t)
+    };
+
+    // Descriptor of a column by name; usable in constant expressions
+    constexpr std::optional<ColumnDescriptor> find_column(std::string_view name) {
+        for (const auto& column : COLUMN_SCHEMA) {
+            if (column.name == name) {
+                return column;
+            }
+        }
+        return std::nullopt;
+    }
+
+    constexpr int max_schema_column() {
+        int max = -1;
+        for (const auto& column : COLUMN_SCHEMA) {
+            max = column.csv_index > max ? column.csv_index : max;
+        }
+        return max;
+    }
+
+    // Money flag of every CSV column, by index
+    inline constexpr auto MONEY_COLUMNS = [] {
+        std::array<bool, max_schema_column() + 1> money{};
+        for (const auto& column : COLUMN_SCHEMA) {
+            money[column.csv_index] = money[column.csv_index] || column.money;
+        }
+        return money;
+    }();
+
+    // True when the CSV column holds money (ColumnDescriptor::money)
+    constexpr bool is_money_column(int csv_index) {
+        return csv_index >= 0 && csv_index < static_cast<int>(MONEY_COLUMNS.size())
+            && MONEY_COLUMNS[static_cast<std::size_t>(csv_index)];
+    }
+
+    // How a record field is filled from its column's text
+    enum class FieldCodec { TEXT, INTEGER, MONEY, COORDINATE, DATE, BOROUGH, BUILDING_CLASS, FLAG };
+
+    // One record field tied to its schema column through a member pointer
+    // of the record type
+    template <FieldCodec Codec, typename Member>
+    struct FieldDescriptor {
+        static constexpr FieldCodec codec = Codec;
+
+        std::string_view name;
+        Member member;
+        int csv_index = 0;
+        ColumnCategory category = ColumnCategory::STRING;
+        unsigned bit = 0;           // Flag fields: bit in Flags::value()
+    };
+
+    template <FieldCodec Codec, typename Member>
+    constexpr FieldDescriptor<Codec, Member> field(std::string_view name, Member member, unsigned bit = 0) {
+        const auto column = find_column(name);
+        if (!column) {
+            // Fails constant evaluation: every field needs a schema column
+            throw std::logic_error("field has no schema column");
+        }
+        if ((Codec == FieldCodec::MONEY) != column->money) {
+            // Queries and parse_row must read the column in the same unit
+            throw std::logic_error("money field and schema column disagree");
+        }
+        return {name, member, column->csv_index, column->category, bit};
+    }
+
+    // Every field of a DobJobApplication-shaped record (DobJobApplication or
+    // DobJobApplicationView) that has a CSV column, in declaration order.
+    // applicant_business_phone has none and is left empty by parse_row.
+    template <typename Record>
+    inline constexpr auto RECORD_FIELDS = std::make_tuple(
+        field<FieldCodec::INTEGER>("job_number", &Record::job_number),
+        field<FieldCodec::INTEGER>("doc_number", &Record::doc_number),
+        field<FieldCodec::BOROUGH>("borough", &Record::borough),
+        field<FieldCodec::INTEGER>("bin", &Record::bin),
+
+        field<FieldCodec::TEXT>("house_number", &Record::house_number),
+        field<FieldCodec::TEXT>("street_name", &Record::street_name),
+        field<FieldCodec::INTEGER>("block", &Record::block),
+        field<FieldCodec::INTEGER>("lot", &Record::lot),
+        field<FieldCodec::TEXT>("city", &Record::city),
+        field<FieldCodec::TEXT>("state", &Record::state),
+        field<FieldCodec::TEXT>("zip", &Record::zip),
+        field<FieldCodec::INTEGER>("community_board", &Record::community_board),
+        field<FieldCodec::INTEGER>("council_district", &Record::council_district),
+        field<FieldCodec::INTEGER>("census_tract", &Record::census_tract),
+        field<FieldCodec::TEXT>("nta_name", &Record::nta_name),
+        field<FieldCodec::COORDINATE>("latitude", &Record::latitude),
+        field<FieldCodec::COORDINATE>("longitude", &Record::longitude),
+
+        field<FieldCodec::TEXT>("job_type", &Record::job_type),
+        field<FieldCodec::TEXT>("job_status", &Record::job_status),
+        field<FieldCodec::TEXT>("building_type", &Record::building_type),
+        field<FieldCodec::BUILDING_CLASS>("building_class", &Record::building_class),
+        field<FieldCodec::TEXT>("work_type", &Record::work_type),
+        field<FieldCodec::TEXT>("permit_type", &Record::permit_type),
+        field<FieldCodec::TEXT>("filing_status", &Record::filing_status),
+
+        field<FieldCodec::DATE>("filing_date", &Record::filing_date),
+        field<FieldCodec::DATE>("issuance_date", &Record::issuance_date),
+        field<FieldCodec::DATE>("expiration_date", &Record::expiration_date),
+        field<FieldCodec::DATE>("latest_action_date", &Record::latest_action_date),
+        field<FieldCodec::DATE>("special_action_date", &Record::special_action_date),
+        field<FieldCodec::DATE>("signoff_date", &Record::signoff_date),
+
+        field<FieldCodec::TEXT>("owner_type", &Record::owner_type),
+        field<FieldCodec::TEXT>("owner_name", &Record::owner_name),
+        field<FieldCodec::TEXT>("owner_business_name", &Record::owner_business_name),
+        field<FieldCodec::TEXT>("owner_house_number", &Record::owner_house_number),
+        field<FieldCodec::TEXT>("owner_street_name", &Record::owner_street_name),
+        field<FieldCodec::TEXT>("owner_city", &Record::owner_city),
+        field<FieldCodec::TEXT>("owner_state", &Record::owner_state),
+        field<FieldCodec::TEXT>("owner_zip", &Record::owner_zip),
+        field<FieldCodec::TEXT>("owner_phone", &Record::owner_phone),
+
+        field<FieldCodec::TEXT>("applicant_first_name", &Record::applicant_first_name),
+        field<FieldCodec::TEXT>("applicant_last_name", &Record::applicant_last_name),
+        field<FieldCodec::TEXT>("applicant_business_name", &Record::applicant_business_name),
+        field<FieldCodec::TEXT>("applicant_professional_title", &Record::applicant_professional_title),
+        field<FieldCodec::TEXT>("applicant_license", &Record::applicant_license),
+        field<FieldCodec::TEXT>("applicant_professional_cert", &Record::applicant_professional_cert),
+
+        field<FieldCodec::INTEGER>("existing_dwelling_units", &Record::existing_dwelling_units),
+        field<FieldCodec::INTEGER>("proposed_dwelling_units", &Record::proposed_dwelling_units),
+        field<FieldCodec::INTEGER>("existing_stories", &Record::existing_stories),
+        field<FieldCodec::INTEGER>("proposed_stories", &Record::proposed_stories),
+        field<FieldCodec::INTEGER>("existing_height", &Record::existing_height),
+        field<FieldCodec::INTEGER>("proposed_height", &Record::proposed_height),
+
+        field<FieldCodec::MONEY>("initial_cost_cents", &Record::initial_cost_cents),
+        field<FieldCodec::MONEY>("total_est_fee_cents", &Record::total_est_fee_cents),
+        field<FieldCodec::MONEY>("paid_fee_cents", &Record::paid_fee_cents),
+
+        field<FieldCodec::TEXT>("zoning_district_1", &Record::zoning_district_1),
+        field<FieldCodec::TEXT>("zoning_district_2", &Record::zoning_district_2),
+        field<FieldCodec::TEXT>("zoning_district_3", &Record::zoning_district_3),
+        field<FieldCodec::TEXT>("zoning_district_4", &Record::zoning_district_4),
+        field<FieldCodec::TEXT>("zoning_district_5", &Record::zoning_district_5),
+        field<FieldCodec::TEXT>("special_district_1", &Record::special_district_1),
+        field<FieldCodec::TEXT>("special_district_2", &Record::special_district_2),
+
+        field<FieldCodec::FLAG>("residential", &Record::flags, 0),
+        field<FieldCodec::FLAG>("plumbing", &Record::flags, 1),
+        field<FieldCodec::FLAG>("sprinkler", &Record::flags, 2),
+        field<FieldCodec::FLAG>("fire_alarm", &Record::flags, 3),
+        field<FieldCodec::FLAG>("mechanical", &Record::flags, 4),
+        field<FieldCodec::FLAG>("boiler", &Record::flags, 5),
+        field<FieldCodec::FLAG>("fuel_burning", &Record::flags, 6),
+        field<FieldCodec::FLAG>("curb_cut", &Record::flags, 7),
+
+        field<FieldCodec::INTEGER>("job_no_good_count", &Record::job_no_good_count)
+    );
+
+}
@@ -0,0 +1,294 @@
+#include "Aggregation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace query {
+
+    namespace {
+        const char* op_name(AggregateOp op) {
+            switch (op) {
+                case AggregateOp::COUNT: return "COUNT";
+                case AggregateOp::SUM: return "SUM";
+                case AggregateOp::MIN: return "MIN";
+                case AggregateOp::MAX: return "MAX";
+                case AggregateOp::AVG: return "AVG";
+            }
+            return "?";
+        }
+
+        template <typename T>
+        void append_bytes(std::string& out, const T& value) {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.append(bytes, sizeof(T));
+        }
+
+        // Value of an aggregated column; a string column only reports
+        // whether the row holds it
+        std::optional<double> read_value(RowContext& row, int column, dob::ColumnCategory category) {
+            switch (category) {
+                case dob::ColumnCategory::NUMERIC:
+                    return row.number(column);
+                case dob::ColumnCategory::DATE:
+                    if (auto date = row.date(column)) { return static_cast<double>(*date); }
+                    return std::nullopt;
+                case dob::ColumnCategory::BOOLEAN:
+                    if (auto flag = row.flag(column)) { return *flag ? 1.0 : 0.0; }
+                    return std::nullopt;
+                case dob::ColumnCategory::STRING:
+                    if (row.text(column)) { return 1.0; }
+                    return std::nullopt;
+            }
+            return std::nullopt;
+        }
+
+        // Variant order, except that NaN keys sort after every other
+        // number instead of breaking the strict weak ordering
+        bool key_less(const FieldValue& a, const FieldValue& b) {
+            const auto* x = std::get_if<double>(&a);
+            const auto* y = std::get_if<double>(&b);
+            if (x && y && (std::isnan(*x) || std::isnan(*y))) {
+                return !std::isnan(*x);
+            }
+            return a < b;
+        }
+    }
+
+    GroupBy::GroupBy(const std::vector<std::string>& keys, std::vector<Aggregate> aggregates) {
+        if (aggregates.empty()) {
+            throw std::invalid_argument("GroupBy needs at least one aggregate");
+        }
+
+        keys_.reserve(keys.size());
+        for (const auto& name : keys) {
+            auto info = dob::column_info(name);
+            if (!info) {
+                throw std::invalid_argument("Column name not found: " + name);
+            }
+            keys_.push_back(Key{name, info->first, info->second});
+            maxColumn_ = std::max(maxColumn_, info->first);
+        }
+
+        aggregates_.reserve(aggregates.size());
+        for (auto& spec : aggregates) {
+            Value value;
+            if (spec.column.empty()) {
+                if (spec.op != AggregateOp::COUNT) {
+                    throw std::invalid_argument(std::string(op_name(spec.op)) + " needs a column");
+                }
+            } else {
+                auto info = dob::column_info(spec.column);
+                if (!info) {
+                    throw std::invalid_argument("Column name not found: " + spec.column);
+                }
+                if (spec.op != AggregateOp::COUNT && info->second == dob::ColumnCategory::STRING) {
+                    throw std::invalid_argument(std::string(op_name(spec.op))
+                                                + " is not supported for STRING columns: " + spec.column);
+                }
+                value.column = info->first;
+                value.category = info->second;
+                maxColumn_ = std::max(maxColumn_, info->first);
+            }
+            value.spec = std::move(spec);
+            aggregates_.push_back(std::move(value));
+        }
+    }
+
+    void GroupTable::Accumulator::add(double value) {
+        if (count == 0) {
+            min = value;
+            max = value;
+        } else {
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+        sum += value;
+        ++count;
+    }
+
+    void GroupTable::Accumulator::merge(const Accumulator& other) {
+        if (other.count == 0) { return; }
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sum += other.sum;
+        count += other.count;
+    }
+
+    GroupTable::GroupTable(const GroupBy& groupBy, const ColumnSource* source)
+        : groupBy_(&groupBy), keyCodes_(groupBy.keys_.size(), false) {
+        for (std::size_t k = 0; k < groupBy.keys_.size(); ++k) {
+            const auto& key = groupBy.keys_[k];
+            keyCodes_[k] = source && key.category == dob::ColumnCategory::STRING && source->has_codes(key.column);
+        }
+    }
+
+    // Each key is a presence byte followed by its fixed-size value (or
+    // length-prefixed text), so distinct keys never encode alike
+    void GroupTable::encode_key(RowContext& row) {
+        scratch_.clear();
+        for (std::size_t k = 0; k < groupBy_->keys_.size(); ++k) {
+            const auto& key = groupBy_->keys_[k];
+            switch (key.category) {
+                case dob::ColumnCategory::STRING:
+                    if (keyCodes_[k]) {
+                        auto code = row.code(key.column);
+                        scratch_.push_back(code ? '\1' : '\0');
+                        if (code) { append_bytes(scratch_, *code); }
+                    } else {
+                        auto text = row.text(key.column);
+                        scratch_.push_back(text ? '\1' : '\0');
+                        if (text) {
+                            append_bytes(scratch_, static_cast<uint32_t>(text->size()));
+                            scratch_.append(*text);
+                        }
+                    }
+                    break;
+                case dob::ColumnCategory::BOOLEAN: {
+                    auto flag = row.flag(key.column);
+                    scratch_.push_back(flag ? '\1' : '\0');
+                    if (flag) { scratch_.push_back(*flag ? '\1' : '\0'); }
+                    break;
+                }
+                case dob::ColumnCategory::NUMERIC: {
+                    auto number = row.number(key.column);
+                    scratch_.push_back(number ? '\1' : '\0');
+                    if (number) {
+                        // One encoding for 0.0 / -0.0 and for every NaN
+                        double value = *number == 0.0 ? 0.0 : *number;
+                        if (std::isnan(value)) { value = std::numeric_limits<double>::quiet_NaN(); }
+                        append_bytes(scratch_, value);
+                    }
+                    break;
+                }
+                case dob::ColumnCategory::DATE: {
+                    auto date = row.date(key.column);
+                    scratch_.push_back(date ? '\1' : '\0');
+                    if (date) { append_bytes(scratch_, *date); }
+                    break;
+                }
+            }
+        }
+    }
+
+    GroupTable::Group GroupTable::make_group(RowContext& row) const {
+        Group group;
+        group.keys.resize(groupBy_->keys_.size());
+        group.values.resize(groupBy_->aggregates_.size());
+
+        for (std::size_t k = 0; k < groupBy_->keys_.size(); ++k) {
+            const auto& key = groupBy_->keys_[k];
+            FieldValue& value = group.keys[k];
+            switch (key.category) {
+                case dob::ColumnCategory::STRING:
+                    if (auto v = row.text(key.column)) { value.emplace<std::string>(*v); }
+                    break;
+                case dob::ColumnCategory::BOOLEAN:
+                    if (auto v = row.flag(key.column)) { value.emplace<bool>(*v); }
+                    break;
+                case dob::ColumnCategory::NUMERIC:
+                    if (auto v = row.number(key.column)) { value.emplace<double>(*v); }
+                    break;
+                case dob::ColumnCategory::DATE:
+                    if (auto v = row.date(key.column)) { value.emplace<dob::Date>(*v); }
+                    break;
+            }
+        }
+        return group;
+    }
+
+    void GroupTable::add(RowContext& row) {
+        encode_key(row);
+
+        std::size_t position;
+        auto it = index_.find(scratch_);
+        if (it == index_.end()) {
+            position = groups_.size();
+            groups_.push_back(make_group(row));
+            index_.emplace(scratch_, position);
+        } else {
+            position = it->second;
+        }
+
+        Group& group = groups_[position];
+        ++group.rows;
+        for (std::size_t a = 0; a < groupBy_->aggregates_.size(); ++a) {
+            const auto& aggregate = groupBy_->aggregates_[a];
+            if (aggregate.column < 0) { continue; }
+            if (auto value = read_value(row, aggregate.column, aggregate.category)) {
+                group.values[a].add(*value);
+            }
+        }
+    }
+
+    void GroupTable::merge(GroupTable&& other) {
+        for (auto& [key, position] : other.index_) {
+            Group& theirs = other.groups_[position];
+            auto it = index_.find(key);
+            if (it == index_.end()) {
+                index_.emplace(key, groups_.size());
+                groups_.push_back(std::move(theirs));
+                continue;
+            }
+
+            Group& mine = groups_[it->second];
+            mine.rows += theirs.rows;
+            for (std::size_t a = 0; a < mine.values.size(); ++a) {
+                mine.values[a].merge(theirs.values[a]);
+            }
+        }
+        other.index_.clear();
+        other.groups_.clear();
+    }
+
+    std::vector<GroupRow> GroupTable::rows() const {
+        std::vector<GroupRow> result;
+        result.reserve(groups_.size());
+
+        for (const auto& group : groups_) {
+            GroupRow& row = result.emplace_back();
+            row.keys = group.keys;
+            row.rows = group.rows;
+            row.values.reserve(group.values.size());
+
+            for (std::size_t a = 0; a < group.values.size(); ++a) {
+                const auto& aggregate = groupBy_->aggregates_[a];
+                const Accumulator& acc = group.values[a];
+                std::optional<double> value;
+                switch (aggregate.spec.op) {
+                    case AggregateOp::COUNT:
+                        value = static_cast<double>(aggregate.column < 0 ? group.rows : acc.count);
+                        break;
+                    case AggregateOp::SUM:
+                        if (acc.count) { value = acc.sum; }
+                        break;
+                    case AggregateOp::MIN:
+                        if (acc.count) { value = acc.min; }
+                        break;
+                    case AggregateOp::MAX:
+                        if (acc.count) { value = acc.max; }
+                        break;
+                    case AggregateOp::AVG:
+                        if (acc.count) { value = acc.sum / static_cast<double>(acc.count); }
+                        break;
+                }
+                row.values.push_back(value);
+            }
+        }
+
+        std::sort(result.begin(), result.end(),
+                  [](const GroupRow& a, const GroupRow& b) {
+                      return std::lexicographical_compare(a.keys.begin(), a.keys.end(),
+                                                          b.keys.begin(), b.keys.end(), key_less);
+                  });
+        return result;
+    }
+
+}
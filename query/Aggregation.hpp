@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../dob/DobParseUtils.hpp"
+#include "Projection.hpp"
+#include "Querys.hpp"
+
+namespace query {
+
+    enum class AggregateOp { COUNT, SUM, MIN, MAX, AVG };
+
+    // One aggregate of a GroupBy. COUNT without a column counts the rows of
+    // the group; every other aggregate (and COUNT of a column) only sees the
+    // rows that hold the column. Dates aggregate as their YYYYMMDD number,
+    // flags as 0 / 1.
+    struct Aggregate {
+        AggregateOp op = AggregateOp::COUNT;
+        std::string column;
+    };
+
+    // One group of a grouped aggregation
+    struct GroupRow {
+        std::vector<FieldValue> keys;                   // in key order; monostate when the column is missing
+        std::vector<std::optional<double>> values;      // in aggregate order; nullopt when no row held the column
+        std::size_t rows = 0;                           // matching rows in the group
+    };
+
+    // Aggregates over the matches of a query, grouped by COLUMN_SCHEMA
+    // columns. No keys puts every match in a single group.
+    class GroupBy {
+    public:
+        // Throws std::invalid_argument for an unknown column, no aggregates,
+        // or an aggregate other than COUNT over a string column
+        GroupBy(const std::vector<std::string>& keys, std::vector<Aggregate> aggregates);
+
+        std::size_t key_count() const { return keys_.size(); }
+        std::size_t aggregate_count() const { return aggregates_.size(); }
+        const std::string& key_name(std::size_t i) const { return keys_[i].name; }
+        const Aggregate& aggregate(std::size_t i) const { return aggregates_[i].spec; }
+
+        // Highest CSV column index a group needs
+        int max_column() const { return maxColumn_; }
+
+    private:
+        friend class GroupTable;
+
+        struct Key {
+            std::string name;
+            int column = 0;
+            dob::ColumnCategory category = dob::ColumnCategory::STRING;
+        };
+
+        struct Value {
+            Aggregate spec;
+            int column = -1;    // -1: COUNT of rows
+            dob::ColumnCategory category = dob::ColumnCategory::NUMERIC;
+        };
+
+        std::vector<Key> keys_;
+        std::vector<Value> aggregates_;
+        int maxColumn_ = -1;
+    };
+
+    // Hash table of the groups of a GroupBy, filled one row at a time. Each
+    // scan thread fills its own table and merge() folds them together, so
+    // the scan itself never synchronizes.
+    class GroupTable {
+    public:
+        // source is the ColumnSource the rows will be read from, or nullptr
+        // for CSV text; string keys are hashed by dictionary code when the
+        // source has one
+        GroupTable(const GroupBy& groupBy, const ColumnSource* source);
+
+        // Fold in the row context points at
+        void add(RowContext& row);
+
+        // Fold in a table built for the same GroupBy and source
+        void merge(GroupTable&& other);
+
+        std::size_t size() const { return groups_.size(); }
+
+        // The groups, sorted by key
+        std::vector<GroupRow> rows() const;
+
+    private:
+        struct Accumulator {
+            double sum = 0.0;
+            double min = 0.0;
+            double max = 0.0;
+            std::size_t count = 0;
+
+            void add(double value);
+            void merge(const Accumulator& other);
+        };
+
+        struct Group {
+            std::vector<FieldValue> keys;
+            std::vector<Accumulator> values;
+            std::size_t rows = 0;
+        };
+
+        const GroupBy* groupBy_;
+        std::vector<bool> keyCodes_;    // per key: hashed by dictionary code
+
+        // Group keys encoded as bytes -> position in groups_
+        std::unordered_map<std::string, std::size_t> index_;
+        std::vector<Group> groups_;
+        std::string scratch_;
+
+        void encode_key(RowContext& row);
+        Group make_group(RowContext& row) const;
+    };
+
+}
@@ -0,0 +1,221 @@
+#include "BatchKernels.hpp"
+
+#include <algorithm>
+
+#include "../dob/DobCsvScan.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define QUERY_BATCH_AVX2 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define QUERY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define QUERY_TARGET_AVX2
+#endif
+#endif
+
+namespace query {
+
+    namespace {
+
+        using RangeF64Fn = void (*)(const double*, std::size_t, double, double, BatchMask&);
+        using RangeI32Fn = void (*)(const int32_t*, std::size_t, int32_t, int32_t, BatchMask&);
+        using RangeU32Fn = void (*)(const uint32_t*, std::size_t, uint32_t, uint32_t, BatchMask&);
+        using GreaterU16Fn = void (*)(const uint16_t*, std::size_t, uint16_t, BatchMask&);
+
+        // Rows [from, count) one at a time; out must be cleared up front
+        template <typename T, typename Pass>
+        void pack_scalar(const T* values, std::size_t from, std::size_t count, Pass pass, BatchMask& out) {
+            for (std::size_t i = from; i < count; ++i) {
+                out[i / 64] |= static_cast<uint64_t>(pass(values[i])) << (i % 64);
+            }
+        }
+
+        void in_range_f64_scalar(const double* values, std::size_t count, double lo, double hi, BatchMask& out) {
+            out.fill(0);
+            pack_scalar(values, 0, count, [=](double v) { return v >= lo && v <= hi; }, out);
+        }
+
+        void in_range_i32_scalar(const int32_t* values, std::size_t count, int32_t lo, int32_t hi, BatchMask& out) {
+            out.fill(0);
+            pack_scalar(values, 0, count, [=](int32_t v) { return v >= lo && v <= hi; }, out);
+        }
+
+        void in_range_u32_scalar(const uint32_t* values, std::size_t count, uint32_t lo, uint32_t hi, BatchMask& out) {
+            out.fill(0);
+            pack_scalar(values, 0, count, [=](uint32_t v) { return v >= lo && v <= hi; }, out);
+        }
+
+        void greater_u16_scalar(const uint16_t* values, std::size_t count, uint16_t threshold, BatchMask& out) {
+            out.fill(0);
+            pack_scalar(values, 0, count, [=](uint16_t v) { return v > threshold; }, out);
+        }
+
+#ifdef QUERY_BATCH_AVX2
+        // Each kernel fills whole 64-row words from vector compares and
+        // leaves the last partial word to pack_scalar
+
+        QUERY_TARGET_AVX2
+        void in_range_f64_avx2(const double* values, std::size_t count, double lo, double hi, BatchMask& out) {
+            out.fill(0);
+            const __m256d low = _mm256_set1_pd(lo);
+            const __m256d high = _mm256_set1_pd(hi);
+
+            std::size_t i = 0;
+            for (; i + 64 <= count; i += 64) {
+                uint64_t bits = 0;
+                for (std::size_t j = 0; j < 64; j += 4) {
+                    const __m256d v = _mm256_loadu_pd(values + i + j);
+                    const __m256d pass = _mm256_and_pd(_mm256_cmp_pd(v, low, _CMP_GE_OQ),
+                                                       _mm256_cmp_pd(v, high, _CMP_LE_OQ));
+                    bits |= static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_pd(pass))) << j;
+                }
+                out[i / 64] = bits;
+            }
+            pack_scalar(values, i, count, [=](double v) { return v >= lo && v <= hi; }, out);
+        }
+
+        QUERY_TARGET_AVX2
+        void in_range_i32_avx2(const int32_t* values, std::size_t count, int32_t lo, int32_t hi, BatchMask& out) {
+            out.fill(0);
+            const __m256i low = _mm256_set1_epi32(lo);
+            const __m256i high = _mm256_set1_epi32(hi);
+
+            std::size_t i = 0;
+            for (; i + 64 <= count; i += 64) {
+                uint64_t bits = 0;
+                for (std::size_t j = 0; j < 64; j += 8) {
+                    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + j));
+                    const __m256i fail = _mm256_or_si256(_mm256_cmpgt_epi32(low, v), _mm256_cmpgt_epi32(v, high));
+                    const auto failed = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(fail)));
+                    bits |= static_cast<uint64_t>(~failed & 0xFFu) << j;
+                }
+                out[i / 64] = bits;
+            }
+            pack_scalar(values, i, count, [=](int32_t v) { return v >= lo && v <= hi; }, out);
+        }
+
+        // Unsigned: v is in range when clamping it to [lo, hi] leaves it unchanged
+        QUERY_TARGET_AVX2
+        void in_range_u32_avx2(const uint32_t* values, std::size_t count, uint32_t lo, uint32_t hi, BatchMask& out) {
+            out.fill(0);
+            const __m256i low = _mm256_set1_epi32(static_cast<int>(lo));
+            const __m256i high = _mm256_set1_epi32(static_cast<int>(hi));
+
+            std::size_t i = 0;
+            for (; i + 64 <= count; i += 64) {
+                uint64_t bits = 0;
+                for (std::size_t j = 0; j < 64; j += 8) {
+                    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + j));
+                    const __m256i clamped = _mm256_min_epu32(_mm256_max_epu32(v, low), high);
+                    const __m256i pass = _mm256_cmpeq_epi32(clamped, v);
+                    bits |= static_cast<uint64_t>(static_cast<unsigned>(
+                        _mm256_movemask_ps(_mm256_castsi256_ps(pass)))) << j;
+                }
+                out[i / 64] = bits;
+            }
+            pack_scalar(values, i, count, [=](uint32_t v) { return v >= lo && v <= hi; }, out);
+        }
+
+        // Widened to 32 bits, where the signed compare is exact
+        QUERY_TARGET_AVX2
+        void greater_u16_avx2(const uint16_t* values, std::size_t count, uint16_t threshold, BatchMask& out) {
+            out.fill(0);
+            const __m256i limit = _mm256_set1_epi32(threshold);
+
+            std::size_t i = 0;
+            for (; i + 64 <= count; i += 64) {
+                uint64_t bits = 0;
+                for (std::size_t j = 0; j < 64; j += 8) {
+                    const __m128i narrow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i + j));
+                    const __m256i pass = _mm256_cmpgt_epi32(_mm256_cvtepu16_epi32(narrow), limit);
+                    bits |= static_cast<uint64_t>(static_cast<unsigned>(
+                        _mm256_movemask_ps(_mm256_castsi256_ps(pass)))) << j;
+                }
+                out[i / 64] = bits;
+            }
+            pack_scalar(values, i, count, [=](uint16_t v) { return v > threshold; }, out);
+        }
+#endif
+
+        struct Dispatch {
+            RangeF64Fn range_f64 = in_range_f64_scalar;
+            RangeI32Fn range_i32 = in_range_i32_scalar;
+            RangeU32Fn range_u32 = in_range_u32_scalar;
+            GreaterU16Fn greater_u16 = greater_u16_scalar;
+            const char* name = "scalar";
+
+            Dispatch() {
+#ifdef QUERY_BATCH_AVX2
+                if (dob::cpu_has_avx2()) {
+                    range_f64 = in_range_f64_avx2;
+                    range_i32 = in_range_i32_avx2;
+                    range_u32 = in_range_u32_avx2;
+                    greater_u16 = greater_u16_avx2;
+                    name = "avx2";
+                }
+#endif
+            }
+        };
+
+        const Dispatch& dispatch() {
+            static const Dispatch d;
+            return d;
+        }
+
+    }
+
+    void clear_tail(BatchMask& mask, std::size_t count) {
+        const std::size_t words = mask_words(count);
+        if (count % 64 != 0) {
+            mask[words - 1] &= (uint64_t{1} << (count % 64)) - 1;
+        }
+        std::fill(mask.begin() + static_cast<std::ptrdiff_t>(words), mask.end(), uint64_t{0});
+    }
+
+    void mask_in_range(const double* values, std::size_t count, double lo, double hi, BatchMask& out) {
+        dispatch().range_f64(values, count, lo, hi, out);
+    }
+
+    void mask_in_range(const int32_t* values, std::size_t count, int32_t lo, int32_t hi, BatchMask& out) {
+        if (lo > hi) {
+            out.fill(0);
+            return;
+        }
+        dispatch().range_i32(values, count, lo, hi, out);
+    }
+
+    void mask_in_range(const uint32_t* values, std::size_t count, uint32_t lo, uint32_t hi, BatchMask& out) {
+        // The clamping kernel assumes a non-empty range
+        if (lo > hi) {
+            out.fill(0);
+            return;
+        }
+        dispatch().range_u32(values, count, lo, hi, out);
+    }
+
+    void mask_greater(const uint16_t* values, std::size_t count, uint16_t threshold, BatchMask& out) {
+        dispatch().greater_u16(values, count, threshold, out);
+    }
+
+    void mask_bits(const uint64_t* bitmap, std::size_t begin, std::size_t count, BatchMask& out) {
+        const uint64_t* words = bitmap + begin / 64;
+        const std::size_t shift = begin % 64;
+        const std::size_t end = begin + count;
+
+        for (std::size_t w = 0; w < mask_words(count); ++w) {
+            uint64_t bits = words[w] >> shift;
+            // The next source word is only read when it holds rows of the block
+            if (shift != 0 && (begin / 64 + w + 1) * 64 < end) {
+                bits |= words[w + 1] << (64 - shift);
+            }
+            out[w] = bits;
+        }
+        clear_tail(out, count);
+    }
+
+    const char* batch_isa() {
+        return dispatch().name;
+    }
+
+}
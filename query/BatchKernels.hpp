@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace query {
+
+    // Rows evaluated together by Query::eval_batch, and the selection mask
+    // over them: bit i % 64 of word i / 64 stands for the block's row i
+    constexpr std::size_t kBatchRows = 1024;
+    using BatchMask = std::array<uint64_t, kBatchRows / 64>;
+
+    // Words of a mask that hold the bits of count rows
+    constexpr std::size_t mask_words(std::size_t count) { return (count + 63) / 64; }
+
+    // Zero every bit at or past count
+    void clear_tail(BatchMask& mask, std::size_t count);
+
+    // Kernels testing values[0, count) (count <= kBatchRows) into out: bit i
+    // is set when values[i] passes. Bits past count are cleared. Dispatched
+    // once at runtime to AVX2 or a scalar loop.
+
+    // lo <= values[i] <= hi; NaN never passes
+    void mask_in_range(const double* values, std::size_t count, double lo, double hi, BatchMask& out);
+    void mask_in_range(const int32_t* values, std::size_t count, int32_t lo, int32_t hi, BatchMask& out);
+    void mask_in_range(const uint32_t* values, std::size_t count, uint32_t lo, uint32_t hi, BatchMask& out);
+
+    // values[i] > threshold
+    void mask_greater(const uint16_t* values, std::size_t count, uint16_t threshold, BatchMask& out);
+
+    // Bits [begin, begin + count) of a packed bitmap, moved down to bit 0
+    void mask_bits(const uint64_t* bitmap, std::size_t begin, std::size_t count, BatchMask& out);
+
+    // Name of the implementation the kernels dispatch to
+    const char* batch_isa();
+
+}
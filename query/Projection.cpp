@@ -0,0 +1,66 @@
+#include "Projection.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace query {
+
+    Projection::Projection(const std::vector<std::string>& columns) {
+        if (columns.empty()) {
+            throw std::invalid_argument("Projection needs at least one column");
+        }
+
+        fields_.reserve(columns.size());
+        for (const auto& name : columns) {
+            auto info = dob::column_info(name);
+            if (!info) {
+                throw std::invalid_argument("Column name not found: " + name);
+            }
+            fields_.push_back(Field{name, info->first, info->second});
+            maxColumn_ = std::max(maxColumn_, info->first);
+        }
+    }
+
+    std::optional<std::size_t> Projection::position(std::string_view name) const {
+        for (std::size_t i = 0; i < fields_.size(); ++i) {
+            if (fields_[i].name == name) { return i; }
+        }
+        return std::nullopt;
+    }
+
+    void Projection::fill(RowContext& row, ProjectedRow& out) const {
+        out.values.resize(fields_.size());
+
+        for (std::size_t i = 0; i < fields_.size(); ++i) {
+            const Field& f = fields_[i];
+            FieldValue& value = out.values[i];
+            switch (f.category) {
+                case dob::ColumnCategory::STRING:
+                    if (auto v = row.text(f.column)) {
+                        // Assign in place so a reused row keeps its capacity
+                        if (auto* s = std::get_if<std::string>(&value)) {
+                            s->assign(*v);
+                        } else {
+                            value.emplace<std::string>(*v);
+                        }
+                    } else {
+                        value.emplace<std::monostate>();
+                    }
+                    break;
+                case dob::ColumnCategory::NUMERIC:
+                    if (auto v = row.number(f.column)) { value.emplace<double>(*v); }
+                    else { value.emplace<std::monostate>(); }
+                    break;
+                case dob::ColumnCategory::BOOLEAN:
+                    if (auto v = row.flag(f.column)) { value.emplace<bool>(*v); }
+                    else { value.emplace<std::monostate>(); }
+                    break;
+                case dob::ColumnCategory::DATE:
+                    if (auto v = row.date(f.column)) { value.emplace<dob::Date>(*v); }
+                    else { value.emplace<std::monostate>(); }
+                    break;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "../dob/DobParseUtils.hpp"
+#include "Querys.hpp"
+
+namespace query {
+
+    // One projected field: text for STRING columns, double for NUMERIC,
+    // bool for BOOLEAN and Date for DATE; monostate when the row has no such
+    // column
+    using FieldValue = std::variant<std::monostate, std::string, double, bool, dob::Date>;
+
+    // The projected fields of one matching row, in projection order
+    struct ProjectedRow {
+        std::size_t row = 0;    // row index in the file
+        std::vector<FieldValue> values;
+
+        const FieldValue& operator[](std::size_t i) const { return values[i]; }
+    };
+
+    // The COLUMN_SCHEMA columns a query should materialize for each match.
+    // Rows are split no further than the highest projected column and only
+    // the projected fields are parsed.
+    class Projection {
+    public:
+        // Throws std::invalid_argument for an unknown or empty column list
+        explicit Projection(const std::vector<std::string>& columns);
+
+        std::size_t size() const { return fields_.size(); }
+        const std::string& name(std::size_t i) const { return fields_[i].name; }
+        dob::ColumnCategory category(std::size_t i) const { return fields_[i].category; }
+
+        // Highest CSV column index a projected row needs
+        int max_column() const { return maxColumn_; }
+
+        // Position of a column in the projection, or nullopt
+        std::optional<std::size_t> position(std::string_view name) const;
+
+        // Read the projected fields of the row context points at into
+        // out.values, reusing their storage (out.row is left to the caller)
+        void fill(RowContext& row, ProjectedRow& out) const;
+
+    private:
+        struct Field {
+            std::string name;
+            int column = 0;
+            dob::ColumnCategory category = dob::ColumnCategory::STRING;
+        };
+
+        std::vector<Field> fields_;
+        int maxColumn_ = -1;
+    };
+
+}
@@ -1,6 +1,14 @@
 #include "Querys.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
 #include <memory>
 #include <any>
+#include <cstdio>
+#include <numeric>
+#include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <typeinfo>
 #include <charconv>
@@ -9,50 +17,6 @@
 namespace query {
 
     namespace {
-        // ...existing code...
-
-        // Parse field to double (for numeric columns)
-        double parse_numeric(std::string_view field) {
-            // Strip quotes if present
-            if (!field.empty() && field.front() == '"' && field.back() == '"') {
-                field = field.substr(1, field.size() - 2);
-            }
-
-            // Handle empty field
-            if (field.empty()) {
-                return 0.0;
-            }
-
-            double val = 0.0;
-            auto result = std::from_chars(field.data(), field.data() + field.size(), val);
-
-            // Check if parsing was successful
-            if (result.ec != std::errc{}) {
-                return 0.0;
-            }
-
-            return val;
-        }
-
-        // Parse string field as string (strip quotes)
-        std::string parse_string(std::string_view field) {
-            if (!field.empty() && field.front() == '"' && field.back() == '"') {
-                field = field.substr(1, field.size() - 2);
-            }
-            return std::string(field);
-        }
-
-        // Parse bool field
-        bool parse_bool(std::string_view field) {
-            // Strip quotes if present
-            if (!field.empty() && field.front() == '"' && field.back() == '"') {
-                field = field.substr(1, field.size() - 2);
-            }
-
-            return field == "1" || field == "true" || field == "True" || field == "TRUE" ||
-                   field == "X" || field == "x" || field == "Y" || field == "y";
-        }
-
         // Safe string extraction from std::any - handles const char*
         std::string safe_any_cast_string(const std::any& value) {
             if (value.type() == typeid(std::string)) {
@@ -73,6 +37,11 @@ namespace query {
                 return static_cast<double>(std::any_cast<int>(value));
             } else if (value.type() == typeid(long)) {
                 return static_cast<double>(std::any_cast<long>(value));
+            } else if (value.type() == typeid(long long)) {
+                return static_cast<double>(std::any_cast<long long>(value));
+            } else if (value.type() == typeid(unsigned int)) {
+                // dob::Date values (YYYYMMDD) arrive as unsigned int
+                return static_cast<double>(std::any_cast<unsigned int>(value));
             } else if (value.type() == typeid(float)) {
                 return static_cast<double>(std::any_cast<float>(value));
             }
@@ -89,90 +58,949 @@ namespace query {
 
     }
 
+    // Column source
+    std::optional<uint32_t> ColumnSource::find_code(int column, std::string_view value) const {
+        const uint32_t code = lower_code(column, value);
+        if (code >= dictionary_size(column) || dictionary_value(column, code) != value) {
+            return std::nullopt;
+        }
+        return code;
+    }
+
+    // Row context
+    RowContext::RowContext(int maxColumn) : maxColumn_(maxColumn) {}
+
+    RowContext::RowContext(std::string_view row, int maxColumn)
+        : row_(row), maxColumn_(maxColumn) {}
+
+    RowContext::RowContext(const ColumnSource& source)
+        : maxColumn_(-1), source_(&source) {}
+
+    void RowContext::reset(std::size_t rowIndex) {
+        rowIndex_ = rowIndex;
+        std::fill(shared_.begin(), shared_.end(), uint8_t{0});
+    }
+
+    bool RowContext::has_column(int column) const {
+        return column >= 0 && column < source_->field_count(rowIndex_);
+    }
+
+    std::optional<std::string_view> RowContext::text(int column) {
+        if (source_) {
+            if (!has_column(column)) { return std::nullopt; }
+            return source_->text(rowIndex_, column);
+        }
+        auto raw = field(column);
+        if (!raw) { return std::nullopt; }
+        if (unescapedUsed_ == unescaped_.size()) { unescaped_.emplace_back(); }
+        const std::string_view text = dob::field_text(*raw, unescaped_[unescapedUsed_]);
+        if (text.data() == unescaped_[unescapedUsed_].data()) { ++unescapedUsed_; }
+        return text;
+    }
+
+    std::optional<double> RowContext::number(int column) {
+        if (source_) {
+            if (!has_column(column)) { return std::nullopt; }
+            return source_->number(rowIndex_, column);
+        }
+        auto raw = field(column);
+        if (!raw) { return std::nullopt; }
+        return dob::parse_number(*raw, column);
+    }
+
+    std::optional<bool> RowContext::flag(int column) {
+        if (source_) {
+            if (!has_column(column)) { return std::nullopt; }
+            return source_->flag(rowIndex_, column);
+        }
+        auto raw = field(column);
+        if (!raw) { return std::nullopt; }
+        return dob::parse_flag(*raw);
+    }
+
+    std::optional<dob::Date> RowContext::date(int column) {
+        if (source_) {
+            if (!has_column(column)) { return std::nullopt; }
+            return source_->date(rowIndex_, column);
+        }
+        auto raw = field(column);
+        if (!raw) { return std::nullopt; }
+        return dob::parse_date(dob::unquote(*raw));
+    }
+
+    void RowContext::reset(std::string_view row) {
+        row_ = row;
+        split_ = false;
+        unescapedUsed_ = 0;
+        std::fill(shared_.begin(), shared_.end(), uint8_t{0});
+    }
+
+    void SharedMasks::reset() {
+        std::fill(known_.begin(), known_.end(), uint8_t{0});
+    }
+
+    void RowContext::reset(std::string_view row, int maxColumn) {
+        reset(row);
+        maxColumn_ = maxColumn;
+    }
+
+    std::optional<uint32_t> RowContext::code(int column) {
+        if (!source_ || !has_column(column)) { return std::nullopt; }
+        return source_->code(rowIndex_, column);
+    }
+
+    std::optional<std::string_view> RowContext::field(int column) {
+        if (column < 0 || source_) {
+            return std::nullopt;
+        }
+
+        // Split once up to the planned column; a read past it (or a context
+        // without a plan) needs the rest of the row
+        if (!split_ || (!complete_ && column >= static_cast<int>(fields_.size()))) {
+            const bool limited = maxColumn_ >= 0 && column <= maxColumn_;
+            if (limited) {
+                dob::split_csv_line(row_, fields_, static_cast<std::size_t>(maxColumn_) + 1);
+                complete_ = fields_.size() <= static_cast<std::size_t>(maxColumn_);
+            } else {
+                dob::split_csv_line(row_, fields_);
+                complete_ = true;
+            }
+            split_ = true;
+        }
+
+        if (column >= static_cast<int>(fields_.size())) {
+            return std::nullopt;
+        }
+        return fields_[column];
+    }
+
+    bool Query::eval(std::string_view row) {
+        static thread_local RowContext context;
+        context.reset(row, max_column());
+        return eval(context);
+    }
+
+    void Query::eval_batch(const ColumnSource& source, std::size_t begin,
+                           std::size_t count, BatchMask& out, SharedMasks* shared) {
+        (void)shared;
+        RowContext row(source);
+        out.fill(0);
+        for (std::size_t i = 0; i < count; ++i) {
+            row.reset(begin + i);
+            if (eval(row)) {
+                out[i / 64] |= uint64_t{1} << (i % 64);
+            }
+        }
+    }
+
+    std::string Query::explain() const {
+        std::ostringstream out;
+        explain(out, 0);
+        return out.str();
+    }
+
+    uint64_t Query::fingerprint() const {
+        uint64_t h = 0xCBF29CE484222325ULL;
+        for (char c : canonical()) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 0x100000001B3ULL;
+        }
+        return h;
+    }
+
+    void Query::canonical_terms(bool conjunctive, std::vector<std::string>& out) const {
+        (void)conjunctive;
+        out.push_back(canonical());
+    }
+
+    namespace {
+        // One row in this many is evaluated against every child of an
+        // AND/OR to learn the children's pass rates
+        constexpr uint32_t kSampleEvery = 64;
+
+        // Relative cost of reading and comparing one field: a typed read
+        // from a column source is an array load, text has to be unquoted
+        // or parsed first
+        double field_cost(dob::ColumnCategory category, bool typed) {
+            if (typed) { return 1.0; }
+            switch (category) {
+                case dob::ColumnCategory::BOOLEAN: return 2.0;
+                case dob::ColumnCategory::STRING: return 3.0;
+                case dob::ColumnCategory::NUMERIC: return 5.0;
+                case dob::ColumnCategory::DATE: return 6.0;
+            }
+            return 4.0;
+        }
+
+        double fraction(std::size_t rows, const ColumnStats& stats) {
+            return stats.rows ? static_cast<double>(rows) / static_cast<double>(stats.rows) : 0.0;
+        }
+
+        // Estimated fraction of values <= x (inclusive) or < x, interpolating
+        // linearly inside the equi-depth bucket that holds x
+        double histogram_fraction(const std::vector<double>& quantiles, double x, bool inclusive) {
+            const auto it = inclusive
+                ? std::upper_bound(quantiles.begin(), quantiles.end(), x)
+                : std::lower_bound(quantiles.begin(), quantiles.end(), x);
+            const auto k = static_cast<std::size_t>(it - quantiles.begin());
+            if (k == 0) { return 0.0; }
+            if (k == quantiles.size()) { return 1.0; }
+
+            const double left = quantiles[k - 1];
+            const double right = quantiles[k];
+            const double within = right > left ? (x - left) / (right - left) : 0.0;
+            return (static_cast<double>(k - 1) + within) / static_cast<double>(quantiles.size() - 1);
+        }
+
+        std::string format_number(double value) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+            return buffer;
+        }
+
+        // Canonical value text: numbers round-trip exactly (with one zero),
+        // strings are quoted, with '"' and '\' escaped by a backslash
+        std::string canonical_number(double value) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value == 0.0 ? 0.0 : value);
+            return buffer;
+        }
+
+        std::string canonical_text(std::string_view value) {
+            std::string out = "\"";
+            for (char c : value) {
+                if (c == '"' || c == '\\') { out.push_back('\\'); }
+                out.push_back(c);
+            }
+            out.push_back('"');
+            return out;
+        }
+
+        // AND / OR over the sorted, deduplicated terms of the children; a
+        // single term stands for itself, and no term at all is the empty
+        // node, which matches nothing
+        std::string canonical_node(const char* name, bool conjunctive,
+                                   const std::vector<std::unique_ptr<Query>>& children) {
+            std::vector<std::string> terms;
+            for (const auto& child : children) {
+                child->canonical_terms(conjunctive, terms);
+            }
+            if (terms.empty()) { return std::string(name) + "()"; }
+            for (const auto& term : terms) {
+                if (term.empty()) { return {}; }
+            }
+            std::sort(terms.begin(), terms.end());
+            terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+            if (terms.size() == 1) { return terms.front(); }
+
+            std::string out = name;
+            out.push_back('(');
+            for (std::size_t i = 0; i < terms.size(); ++i) {
+                if (i > 0) { out.push_back(','); }
+                out.append(terms[i]);
+            }
+            out.push_back(')');
+            return out;
+        }
+
+        void explain_line(std::ostream& out, int depth, const std::string& text,
+                          double cost, double selectivity) {
+            char estimates[64];
+            std::snprintf(estimates, sizeof(estimates), "  [cost %.2f, selectivity %.4f]",
+                          cost, selectivity);
+            out << std::string(static_cast<std::size_t>(depth) * 2, ' ') << text << estimates << '\n';
+        }
+
+        std::size_t popcount(const BatchMask& mask) {
+            std::size_t n = 0;
+            for (uint64_t word : mask) {
+                n += static_cast<std::size_t>(std::popcount(word));
+            }
+            return n;
+        }
+
+        // Whether the first count bits of a mask are all clear / all set
+        bool mask_none(const BatchMask& mask, std::size_t count) {
+            for (std::size_t w = 0; w < mask_words(count); ++w) {
+                if (mask[w] != 0) { return false; }
+            }
+            return true;
+        }
+
+        bool mask_all(const BatchMask& mask, std::size_t count) {
+            return popcount(mask) == count;
+        }
+
+        // Keep the rows of the block that hold the column; a missing column
+        // never matches
+        void mask_present(const uint16_t* fieldCounts, int column, std::size_t begin,
+                          std::size_t count, BatchMask& out) {
+            BatchMask present;
+            mask_greater(fieldCounts + begin, count, static_cast<uint16_t>(column), present);
+            for (std::size_t w = 0; w < mask_words(count); ++w) {
+                out[w] &= present[w];
+            }
+        }
+
+        // The integers of type T inside [lo, hi], or nullopt when there are none
+        template <typename T>
+        std::optional<std::pair<T, T>> integer_bounds(double lo, double hi) {
+            const double low = std::ceil(lo);
+            const double high = std::floor(hi);
+            constexpr double kMin = static_cast<double>(std::numeric_limits<T>::min());
+            constexpr double kMax = static_cast<double>(std::numeric_limits<T>::max());
+            if (!(low <= high) || low > kMax || high < kMin) { return std::nullopt; }
+            return std::pair<T, T>{static_cast<T>(std::max(low, kMin)), static_cast<T>(std::min(high, kMax))};
+        }
+
+        // lo <= value <= hi over a numeric or date column array; false when
+        // the array holds no numbers
+        bool mask_numeric(const ColumnArray& values, std::size_t begin, std::size_t count,
+                          double lo, double hi, BatchMask& out) {
+            switch (values.type) {
+                case ColumnArray::Type::F64:
+                    mask_in_range(values.as<double>() + begin, count, lo, hi, out);
+                    return true;
+                case ColumnArray::Type::I32:
+                    if (auto bounds = integer_bounds<int32_t>(lo, hi)) {
+                        mask_in_range(values.as<int32_t>() + begin, count, bounds->first, bounds->second, out);
+                    } else {
+                        out.fill(0);
+                    }
+                    return true;
+                case ColumnArray::Type::DATE:
+                    if (auto bounds = integer_bounds<dob::Date>(lo, hi)) {
+                        mask_in_range(values.as<dob::Date>() + begin, count, bounds->first, bounds->second, out);
+                    } else {
+                        out.fill(0);
+                    }
+                    return true;
+                default:
+                    return false;
+            }
+        }
+    }
+
+    ChildPlan::ChildPlan(std::size_t children)
+        : order_(children), passes_(std::make_unique<std::atomic<uint64_t>[]>(children)) {
+        std::iota(order_.begin(), order_.end(), std::size_t{0});
+    }
+
+    bool ChildPlan::sample() {
+        // xorshift rather than a counter, so nodes sharing the thread do
+        // not alias onto the same rows
+        static thread_local uint32_t state = 0x9E3779B9u;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % kSampleEvery == 0;
+    }
+
+    void ChildPlan::record(std::size_t child, bool passed) {
+        if (passed) { passes_[child].fetch_add(1, std::memory_order_relaxed); }
+    }
+
+    void ChildPlan::record_batch(std::size_t child, uint64_t passes) {
+        passes_[child].fetch_add(passes, std::memory_order_relaxed);
+    }
+
+    std::optional<double> ChildPlan::observed(std::size_t child) const {
+        const uint64_t samples = samples_.load(std::memory_order_relaxed);
+        if (samples < kMinSamples) { return std::nullopt; }
+        return static_cast<double>(passes_[child].load(std::memory_order_relaxed))
+            / static_cast<double>(samples);
+    }
+
+    void ChildPlan::plan(const std::vector<std::unique_ptr<Query>>& children, bool conjunctive) {
+        const std::size_t n = children.size();
+        std::vector<double> cost(n);
+        std::vector<double> selectivity(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            cost[i] = children[i]->cost();
+            selectivity[i] = observed(i).value_or(children[i]->selectivity());
+        }
+
+        // Cheapest per row decided first: an AND is decided by a failing
+        // child, an OR by a passing one
+        auto rank = [&](std::size_t i) {
+            const double decisive = conjunctive ? 1.0 - selectivity[i] : selectivity[i];
+            return cost[i] / std::max(decisive, 1e-6);
+        };
+        std::iota(order_.begin(), order_.end(), std::size_t{0});
+        std::stable_sort(order_.begin(), order_.end(),
+                         [&](std::size_t a, std::size_t b) { return rank(a) < rank(b); });
+
+        // Each child only runs while the outcome is still open
+        double open = 1.0;
+        cost_ = 0.0;
+        for (std::size_t i : order_) {
+            cost_ += open * cost[i];
+            open *= conjunctive ? selectivity[i] : 1.0 - selectivity[i];
+        }
+        selectivity_ = n == 0 ? 0.0 : (conjunctive ? open : 1.0 - open);
+    }
+
+    void ChildPlan::explain(const std::vector<std::unique_ptr<Query>>& children,
+                            std::ostream& out, int depth) const {
+        for (std::size_t i : order_) {
+            std::ostringstream child;
+            children[i]->explain(child, depth);
+            std::string text = child.str();
+
+            // Note the pass rate that replaced the child's own estimate
+            if (auto rate = observed(i)) {
+                char note[48];
+                std::snprintf(note, sizeof(note), "  (observed %.4f)", *rate);
+                text.insert(text.find('\n'), note);
+            }
+            out << text;
+        }
+    }
+
     // Query implementations
     AndQuery::AndQuery(std::vector<std::unique_ptr<Query>> subqueries)
-        : subqueries_(std::move(subqueries)) {}
+        : subqueries_(std::move(subqueries)), plan_(subqueries_.size()) {
+        plan_.plan(subqueries_, true);
+    }
 
     template<typename... Queries>
-    AndQuery::AndQuery(Queries&&... queries) : subqueries_() {
+    AndQuery::AndQuery(Queries&&... queries) : subqueries_(), plan_(sizeof...(Queries)) {
         (subqueries_.push_back(std::forward<Queries>(queries)), ...);
+        plan_.plan(subqueries_, true);
     }
 
-    bool AndQuery::eval(std::string_view row)  {
+    bool AndQuery::eval(RowContext& row)  {
         if (subqueries_.empty()) { return false; }
-        for (const auto& subquery : subqueries_) {
-            if (!subquery->eval(row)) { return false; }
+
+        if (ChildPlan::sample()) {
+            bool all = true;
+            for (std::size_t i = 0; i < subqueries_.size(); ++i) {
+                const bool passed = subqueries_[i]->eval(row);
+                plan_.record(i, passed);
+                all = all && passed;
+            }
+            plan_.end_sample();
+            return all;
+        }
+
+        for (std::size_t i : plan_.order()) {
+            if (!subqueries_[i]->eval(row)) { return false; }
         }
         return true;
     }
 
+    void AndQuery::eval_batch(const ColumnSource& source, std::size_t begin,
+                              std::size_t count, BatchMask& out, SharedMasks* shared) {
+        out.fill(0);
+        if (subqueries_.empty()) { return; }
+
+        BatchMask child;
+        if (ChildPlan::sample()) {
+            out.fill(~uint64_t{0});
+            for (std::size_t i = 0; i < subqueries_.size(); ++i) {
+                subqueries_[i]->eval_batch(source, begin, count, child, shared);
+                plan_.record_batch(i, popcount(child));
+                for (std::size_t w = 0; w < out.size(); ++w) { out[w] &= child[w]; }
+            }
+            plan_.end_batch(count);
+            return;
+        }
+
+        // Later children still see the whole block; they only stop running
+        // once no row is left
+        const auto& order = plan_.order();
+        subqueries_[order[0]]->eval_batch(source, begin, count, out, shared);
+        for (std::size_t k = 1; k < order.size() && !mask_none(out, count); ++k) {
+            subqueries_[order[k]]->eval_batch(source, begin, count, child, shared);
+            for (std::size_t w = 0; w < mask_words(count); ++w) { out[w] &= child[w]; }
+        }
+    }
+
+    void AndQuery::bind(const ColumnSource* source) {
+        for (const auto& subquery : subqueries_) {
+            subquery->bind(source);
+        }
+        plan_.plan(subqueries_, true);
+    }
+
+    void AndQuery::explain(std::ostream& out, int depth) const {
+        explain_line(out, depth, "AND", cost(), selectivity());
+        plan_.explain(subqueries_, out, depth + 1);
+    }
+
+    void AndQuery::leaves(std::vector<Query*>& out) {
+        for (auto& subquery : subqueries_) {
+            subquery->leaves(out);
+        }
+    }
+
+    std::string AndQuery::canonical() const {
+        return canonical_node("and", true, subqueries_);
+    }
+
+    void AndQuery::canonical_terms(bool conjunctive, std::vector<std::string>& out) const {
+        // An empty AND matches nothing, so it cannot vanish into its parent
+        if (!conjunctive || subqueries_.empty()) {
+            out.push_back(canonical());
+            return;
+        }
+        for (const auto& subquery : subqueries_) {
+            subquery->canonical_terms(true, out);
+        }
+    }
+
+    std::optional<Candidates> AndQuery::candidates(const IndexSource& indexes) const {
+        if (subqueries_.empty()) { return Candidates{RowBitmap{}, true}; }
+
+        // Intersect whatever the indexes can answer; the rest is left to eval
+        std::optional<Candidates> result;
+        bool exact = true;
+        for (const auto& subquery : subqueries_) {
+            auto sub = subquery->candidates(indexes);
+            if (!sub) {
+                exact = false;
+                continue;
+            }
+            exact = exact && sub->exact;
+            result = result ? Candidates{result->rows & sub->rows, false} : std::move(sub);
+        }
+        if (result) {
+            result->exact = exact;
+        }
+        return result;
+    }
+
+    int AndQuery::max_column() const {
+        int column = -1;
+        for (const auto& subquery : subqueries_) {
+            column = std::max(column, subquery->max_column());
+        }
+        return column;
+    }
+
     OrQuery::OrQuery(std::vector<std::unique_ptr<Query>> subqueries)
-        : subqueries_(std::move(subqueries)) {}
+        : subqueries_(std::move(subqueries)), plan_(subqueries_.size()) {
+        plan_.plan(subqueries_, false);
+    }
 
     template<typename... Queries>
-    OrQuery::OrQuery(Queries&&... queries) : subqueries_() {
+    OrQuery::OrQuery(Queries&&... queries) : subqueries_(), plan_(sizeof...(Queries)) {
         (subqueries_.push_back(std::forward<Queries>(queries)), ...);
+        plan_.plan(subqueries_, false);
     }
 
-    bool OrQuery::eval(std::string_view row)  {
+    bool OrQuery::eval(RowContext& row)  {
+        if (codeSource_ && row.source() == codeSource_) {
+            auto code = row.code(codeColumn_);
+            return code && codeSet_[*code] != 0;
+        }
+
         if (subqueries_.empty()) { return false; }
-        for (const auto& subquery : subqueries_) {
-            if (subquery->eval(row)) { return true; }
+
+        if (ChildPlan::sample()) {
+            bool any = false;
+            for (std::size_t i = 0; i < subqueries_.size(); ++i) {
+                const bool passed = subqueries_[i]->eval(row);
+                plan_.record(i, passed);
+                any = any || passed;
+            }
+            plan_.end_sample();
+            return any;
+        }
+
+        for (std::size_t i : plan_.order()) {
+            if (subqueries_[i]->eval(row)) { return true; }
         }
         return false;
     }
 
+    void OrQuery::eval_batch(const ColumnSource& source, std::size_t begin,
+                             std::size_t count, BatchMask& out, SharedMasks* shared) {
+        const uint16_t* fieldCounts = source.field_counts();
+        if (codeSource_ == &source && fieldCounts) {
+            const ColumnArray values = source.column_array(codeColumn_);
+            if (values.type == ColumnArray::Type::CODES) {
+                const uint32_t* codes = values.as<uint32_t>() + begin;
+                out.fill(0);
+                for (std::size_t i = 0; i < count; ++i) {
+                    out[i / 64] |= static_cast<uint64_t>(codeSet_[codes[i]]) << (i % 64);
+                }
+                mask_present(fieldCounts, codeColumn_, begin, count, out);
+                return;
+            }
+        }
+
+        out.fill(0);
+        if (subqueries_.empty()) { return; }
+
+        BatchMask child;
+        if (ChildPlan::sample()) {
+            for (std::size_t i = 0; i < subqueries_.size(); ++i) {
+                subqueries_[i]->eval_batch(source, begin, count, child, shared);
+                plan_.record_batch(i, popcount(child));
+                for (std::size_t w = 0; w < out.size(); ++w) { out[w] |= child[w]; }
+            }
+            plan_.end_batch(count);
+            return;
+        }
+
+        const auto& order = plan_.order();
+        subqueries_[order[0]]->eval_batch(source, begin, count, out, shared);
+        for (std::size_t k = 1; k < order.size() && !mask_all(out, count); ++k) {
+            subqueries_[order[k]]->eval_batch(source, begin, count, child, shared);
+            for (std::size_t w = 0; w < mask_words(count); ++w) { out[w] |= child[w]; }
+        }
+    }
+
+    void OrQuery::bind(const ColumnSource* source) {
+        for (const auto& subquery : subqueries_) {
+            subquery->bind(source);
+        }
+        plan_.plan(subqueries_, false);
+
+        codeSource_ = nullptr;
+        codeColumn_ = -1;
+        codeSet_.clear();
+        if (!source || subqueries_.empty()) { return; }
+
+        // Collapse "col = a OR col = b OR ..." on a dictionary column
+        int column = -1;
+        for (const auto& subquery : subqueries_) {
+            const auto* match = dynamic_cast<const MatchQuery*>(subquery.get());
+            if (!match || match->category() != dob::ColumnCategory::STRING) { return; }
+            if (column >= 0 && match->column_index() != column) { return; }
+            column = match->column_index();
+        }
+        if (!source->has_codes(column)) { return; }
+
+        codeSet_.assign(source->dictionary_size(column), 0);
+        std::size_t rows = 0;
+        for (const auto& subquery : subqueries_) {
+            const auto& match = static_cast<const MatchQuery&>(*subquery);
+            auto code = source->find_code(column, match.text_value());
+            if (code && !codeSet_[*code]) {
+                codeSet_[*code] = 1;
+                rows += source->code_rows(column, *code);
+            }
+        }
+        codeSource_ = source;
+        codeColumn_ = column;
+
+        auto stats = source->stats(column);
+        codeSetSelectivity_ = stats ? fraction(rows, *stats) : plan_.selectivity();
+    }
+
+    double OrQuery::cost() const {
+        return codeSource_ ? 1.0 : plan_.cost();
+    }
+
+    double OrQuery::selectivity() const {
+        return codeSource_ ? codeSetSelectivity_ : plan_.selectivity();
+    }
+
+    void OrQuery::explain(std::ostream& out, int depth) const {
+        explain_line(out, depth, codeSource_ ? "OR (code set)" : "OR", cost(), selectivity());
+        plan_.explain(subqueries_, out, depth + 1);
+    }
+
+    void OrQuery::leaves(std::vector<Query*>& out) {
+        for (auto& subquery : subqueries_) {
+            subquery->leaves(out);
+        }
+    }
+
+    std::string OrQuery::canonical() const {
+        return canonical_node("or", false, subqueries_);
+    }
+
+    void OrQuery::canonical_terms(bool conjunctive, std::vector<std::string>& out) const {
+        if (conjunctive) {
+            out.push_back(canonical());
+            return;
+        }
+        for (const auto& subquery : subqueries_) {
+            subquery->canonical_terms(false, out);
+        }
+    }
+
+    std::optional<Candidates> OrQuery::candidates(const IndexSource& indexes) const {
+        if (subqueries_.empty()) { return Candidates{RowBitmap{}, true}; }
+
+        if (codeSource_) {
+            Candidates result{RowBitmap{}, true};
+            for (uint32_t code = 0; code < codeSet_.size(); ++code) {
+                if (!codeSet_[code]) { continue; }
+                auto rows = indexes.value_rows(codeColumn_, code);
+                if (!rows) { return std::nullopt; }
+                result.rows = result.rows | *rows;
+            }
+            return result;
+        }
+
+        // A union is only bounded if every branch is
+        Candidates result{RowBitmap{}, true};
+        for (const auto& subquery : subqueries_) {
+            auto sub = subquery->candidates(indexes);
+            if (!sub) { return std::nullopt; }
+            result.rows = result.rows | sub->rows;
+            result.exact = result.exact && sub->exact;
+        }
+        return result;
+    }
+
+    int OrQuery::max_column() const {
+        int column = -1;
+        for (const auto& subquery : subqueries_) {
+            column = std::max(column, subquery->max_column());
+        }
+        return column;
+    }
+
     NotQuery::NotQuery(std::unique_ptr<Query> subquery) : subquery_(std::move(subquery)) {}
 
-    bool NotQuery::eval(std::string_view row)  {
+    bool NotQuery::eval(RowContext& row)  {
         return !subquery_->eval(row);
     }
 
-    MatchQuery::MatchQuery(std::string_view column, const std::any& value) {
+    void NotQuery::eval_batch(const ColumnSource& source, std::size_t begin,
+                              std::size_t count, BatchMask& out, SharedMasks* shared) {
+        subquery_->eval_batch(source, begin, count, out, shared);
+        for (std::size_t w = 0; w < mask_words(count); ++w) { out[w] = ~out[w]; }
+        clear_tail(out, count);
+    }
+
+    void NotQuery::bind(const ColumnSource* source) {
+        subquery_->bind(source);
+    }
+
+    void NotQuery::explain(std::ostream& out, int depth) const {
+        explain_line(out, depth, "NOT", cost(), selectivity());
+        subquery_->explain(out, depth + 1);
+    }
+
+    void NotQuery::leaves(std::vector<Query*>& out) {
+        subquery_->leaves(out);
+    }
+
+    std::string NotQuery::canonical() const {
+        std::string sub = subquery_->canonical();
+        if (sub.empty()) { return {}; }
+
+        // NOT NOT x is x
+        if (sub.rfind("not(", 0) == 0) { return sub.substr(4, sub.size() - 5); }
+        return "not(" + sub + ")";
+    }
+
+    std::optional<Candidates> NotQuery::candidates(const IndexSource& indexes) const {
+        // Only an exact set can be complemented
+        auto sub = subquery_->candidates(indexes);
+        if (!sub || !sub->exact) { return std::nullopt; }
+        return Candidates{sub->rows.complement(static_cast<uint32_t>(indexes.row_count())), true};
+    }
+
+    int NotQuery::max_column() const {
+        return subquery_->max_column();
+    }
+
+    MatchQuery::MatchQuery(std::string_view column, const std::any& value) : column_(column) {
         auto info = dob::column_info(column);
         if (!info) {
             throw std::invalid_argument("Column name not found: " + std::string(column));
         }
         columnIndex_ = info->first;
         category_ = info->second;
-        value_ = value;
-        columnType_ = nullptr;  // Not needed anymore since we have category
+
+        // Resolve the std::any once so eval never touches RTTI or allocates
+        switch (category_) {
+            case dob::ColumnCategory::STRING:
+                text_ = safe_any_cast_string(value);
+                evalTyped_ = &MatchQuery::eval_as<dob::ColumnCategory::STRING>;
+                break;
+            case dob::ColumnCategory::BOOLEAN:
+                flag_ = safe_any_cast_bool(value);
+                evalTyped_ = &MatchQuery::eval_as<dob::ColumnCategory::BOOLEAN>;
+                break;
+            case dob::ColumnCategory::NUMERIC:
+                number_ = safe_any_cast_numeric(value);
+                evalTyped_ = &MatchQuery::eval_as<dob::ColumnCategory::NUMERIC>;
+                break;
+            case dob::ColumnCategory::DATE:
+                number_ = safe_any_cast_numeric(value);
+                evalTyped_ = &MatchQuery::eval_as<dob::ColumnCategory::DATE>;
+                break;
+            default:
+                throw std::runtime_error("Unsupported column category");
+        }
+
+        estimate(nullptr);
     }
 
-    bool MatchQuery::eval(std::string_view row)  {
-        static thread_local std::vector<std::string_view> fields;
-        dob::split_csv_line(row, fields);
+    int MatchQuery::max_column() const {
+        return columnIndex_;
+    }
 
-        if (columnIndex_ >= static_cast<int>(fields.size())) {
-            return false;
+    void MatchQuery::bind(const ColumnSource* source) {
+        codeSource_ = nullptr;
+        code_.reset();
+        if (source && category_ == dob::ColumnCategory::STRING && source->has_codes(columnIndex_)) {
+            codeSource_ = source;
+            code_ = source->find_code(columnIndex_, text_);
         }
+        estimate(source);
+    }
 
-        std::string_view field = fields[columnIndex_];
+    void MatchQuery::estimate(const ColumnSource* source) {
+        auto stats = source ? source->stats(columnIndex_) : std::nullopt;
+        cost_ = field_cost(category_, source != nullptr);
 
-        // Compare based on category
         switch (category_) {
-            case dob::ColumnCategory::STRING: {
-                std::string parsed = parse_string(field);
-                std::string val = safe_any_cast_string(value_);
-                return parsed == val;
-            }
-            case dob::ColumnCategory::BOOLEAN: {
-                bool parsed = parse_bool(field);
-                bool val = safe_any_cast_bool(value_);
-                return parsed == val;
-            }
-            case dob::ColumnCategory::NUMERIC: {
-                double parsed = parse_numeric(field);
-                double val = safe_any_cast_numeric(value_);
-                return parsed == val;
-            }
-            default:
-                throw std::runtime_error("Unsupported column category");
+            case dob::ColumnCategory::STRING:
+                if (codeSource_ && stats) {
+                    selectivity_ = code_ ? fraction(source->code_rows(columnIndex_, *code_), *stats) : 0.0;
+                } else {
+                    selectivity_ = 0.1;
+                }
+                break;
+            case dob::ColumnCategory::BOOLEAN:
+                if (stats) {
+                    selectivity_ = fraction(flag_ ? stats->true_rows : stats->present - stats->true_rows, *stats);
+                } else {
+                    selectivity_ = 0.5;
+                }
+                break;
+            case dob::ColumnCategory::NUMERIC:
+            case dob::ColumnCategory::DATE:
+                if (stats) {
+                    // Uniform over the distinct values
+                    const bool inside = stats->present > 0 && number_ >= stats->min && number_ <= stats->max;
+                    selectivity_ = inside
+                        ? fraction(stats->present, *stats) / static_cast<double>(std::max<std::size_t>(1, stats->distinct))
+                        : 0.0;
+                } else {
+                    selectivity_ = 0.05;
+                }
+                break;
+        }
+    }
+
+    void MatchQuery::explain(std::ostream& out, int depth) const {
+        std::string text = "MATCH " + column_ + " = ";
+        switch (category_) {
+            case dob::ColumnCategory::STRING: text.append("\"").append(text_).append("\""); break;
+            case dob::ColumnCategory::BOOLEAN: text.append(flag_ ? "true" : "false"); break;
+            default: text.append(format_number(number_)); break;
+        }
+        explain_line(out, depth, text, cost_, selectivity_);
+    }
+
+    std::string MatchQuery::canonical() const {
+        std::string text = "match(" + column_ + ",";
+        switch (category_) {
+            case dob::ColumnCategory::STRING: text.append(canonical_text(text_)); break;
+            case dob::ColumnCategory::BOOLEAN: text.append(flag_ ? "true" : "false"); break;
+            default: text.append(canonical_number(number_)); break;
+        }
+        text.push_back(')');
+        return text;
+    }
+
+    std::optional<Candidates> MatchQuery::candidates(const IndexSource& indexes) const {
+        std::optional<RowBitmap> rows;
+        if (category_ == dob::ColumnCategory::STRING && codeSource_) {
+            if (!code_) { return Candidates{RowBitmap{}, true}; }
+            rows = indexes.value_rows(columnIndex_, *code_);
+        } else if (category_ == dob::ColumnCategory::BOOLEAN) {
+            rows = indexes.value_rows(columnIndex_, flag_ ? 1u : 0u);
+        }
+        if (rows) { return Candidates{std::move(*rows), true}; }
+
+        // Zone maps only rule out blocks; the rows left still need eval
+        if (category_ == dob::ColumnCategory::STRING) {
+            rows = indexes.zone_rows(columnIndex_, text_);
+        } else if (category_ != dob::ColumnCategory::BOOLEAN) {
+            rows = indexes.zone_rows(columnIndex_, number_, number_);
         }
+        if (rows) { return Candidates{std::move(*rows), false}; }
+        return std::nullopt;
+    }
+
+    // A missing column never matches
+    template <dob::ColumnCategory C>
+    bool MatchQuery::eval_as(RowContext& row) const {
+        auto value = ColumnTraits<C>::read(row, columnIndex_);
+        if (!value) { return false; }
+        if constexpr (C == dob::ColumnCategory::STRING) {
+            return *value == text_;
+        } else if constexpr (C == dob::ColumnCategory::BOOLEAN) {
+            return *value == flag_;
+        } else {
+            return *value == number_;
+        }
+    }
+
+    bool MatchQuery::eval(RowContext& row)  {
+        // A bound string match is a single integer compare
+        if (codeSource_ && row.source() == codeSource_) {
+            if (!code_) { return false; }
+            auto code = row.code(columnIndex_);
+            return code && *code == *code_;
+        }
+
+        if (sharedSlot_ >= 0) {
+            return row.shared(sharedSlot_, [&] { return (this->*evalTyped_)(row); });
+        }
+        return (this->*evalTyped_)(row);
     };
 
+    void MatchQuery::eval_batch(const ColumnSource& source, std::size_t begin,
+                                std::size_t count, BatchMask& out, SharedMasks* shared) {
+        if (shared && sharedSlot_ >= 0) {
+            shared->shared(sharedSlot_, out, [&](BatchMask& mask) { eval_batch(source, begin, count, mask); });
+            return;
+        }
+
+        const uint16_t* fieldCounts = source.field_counts();
+        const ColumnArray values = source.column_array(columnIndex_);
+
+        bool tested = false;
+        if (fieldCounts) {
+            switch (category_) {
+                case dob::ColumnCategory::STRING:
+                    if (codeSource_ == &source && values.type == ColumnArray::Type::CODES) {
+                        if (code_) {
+                            mask_in_range(values.as<uint32_t>() + begin, count, *code_, *code_, out);
+                        } else {
+                            out.fill(0);
+                        }
+                        tested = true;
+                    }
+                    break;
+                case dob::ColumnCategory::BOOLEAN:
+                    if (values.type == ColumnArray::Type::BITMAP) {
+                        mask_bits(values.as<uint64_t>(), begin, count, out);
+                        if (!flag_) {
+                            for (std::size_t w = 0; w < mask_words(count); ++w) { out[w] = ~out[w]; }
+                            clear_tail(out, count);
+                        }
+                        tested = true;
+                    }
+                    break;
+                default:
+                    tested = mask_numeric(values, begin, count, number_, number_, out);
+                    break;
+            }
+        }
+
+        if (!tested) {
+            Query::eval_batch(source, begin, count, out);
+            return;
+        }
+        mask_present(fieldCounts, columnIndex_, begin, count, out);
+    }
 
-    RangeQuery::RangeQuery(std::string_view column, const std::any& minValue, const std::any& maxValue) {
+
+    RangeQuery::RangeQuery(std::string_view column, const std::any& minValue, const std::any& maxValue)
+        : column_(column) {
         auto info = dob::column_info(column);
         if (!info) {
             throw std::invalid_argument("Column name not found: " + std::string(column));
@@ -189,35 +1017,190 @@ namespace query {
             );
         }
 
-        minValue_ = minValue;
-        maxValue_ = maxValue;
+        // Resolve the bounds once so eval never touches RTTI or allocates
+        if (category_ == dob::ColumnCategory::STRING) {
+            minText_ = safe_any_cast_string(minValue);
+            maxText_ = safe_any_cast_string(maxValue);
+            evalTyped_ = &RangeQuery::eval_as<dob::ColumnCategory::STRING>;
+        } else {
+            minNumber_ = safe_any_cast_numeric(minValue);
+            maxNumber_ = safe_any_cast_numeric(maxValue);
+            evalTyped_ = category_ == dob::ColumnCategory::DATE
+                ? &RangeQuery::eval_as<dob::ColumnCategory::DATE>
+                : &RangeQuery::eval_as<dob::ColumnCategory::NUMERIC>;
+        }
+
+        estimate(nullptr);
     }
 
-    bool RangeQuery::eval(std::string_view row) {
-        static thread_local std::vector<std::string_view> fields;
-        dob::split_csv_line(row, fields);
+    int RangeQuery::max_column() const {
+        return columnIndex_;
+    }
 
-        if (columnIndex_ >= static_cast<int>(fields.size())) {
-            return false;
+    void RangeQuery::bind(const ColumnSource* source) {
+        codeSource_ = nullptr;
+        if (source && category_ == dob::ColumnCategory::STRING && source->has_codes(columnIndex_)) {
+            // Sorted dictionary: [min, max] maps to a contiguous code range
+            codeSource_ = source;
+            codeBegin_ = source->lower_code(columnIndex_, minText_);
+            codeEnd_ = codeBegin_;
+            if (minText_ <= maxText_) {
+                codeEnd_ = source->lower_code(columnIndex_, maxText_);
+                auto exact = source->find_code(columnIndex_, maxText_);
+                if (exact) { codeEnd_ = *exact + 1; }
+            }
         }
+        estimate(source);
+    }
 
-        std::string_view field = fields[columnIndex_];
+    void RangeQuery::estimate(const ColumnSource* source) {
+        auto stats = source ? source->stats(columnIndex_) : std::nullopt;
 
         if (category_ == dob::ColumnCategory::STRING) {
-            // Range check on string values
-            std::string parsed = parse_string(field);
-            std::string minVal = safe_any_cast_string(minValue_);
-            std::string maxVal = safe_any_cast_string(maxValue_);
-            return parsed >= minVal && parsed <= maxVal;
-        } else if (category_ == dob::ColumnCategory::BOOLEAN) {
-            throw std::invalid_argument("Range queries are not supported for BOOL columns");
+            // Two compares on text
+            cost_ = field_cost(category_, source != nullptr) + (source ? 0.0 : 1.0);
+            if (codeSource_ && stats) {
+                std::size_t rows = 0;
+                for (uint32_t code = codeBegin_; code < codeEnd_; ++code) {
+                    rows += source->code_rows(columnIndex_, code);
+                }
+                selectivity_ = fraction(rows, *stats);
+            } else {
+                selectivity_ = 0.25;
+            }
+            return;
+        }
+
+        cost_ = field_cost(category_, source != nullptr);
+        if (!stats) {
+            selectivity_ = 0.25;
+            return;
+        }
+
+        const double lo = std::max(minNumber_, stats->min);
+        const double hi = std::min(maxNumber_, stats->max);
+        if (stats->present == 0 || minNumber_ > maxNumber_ || hi < lo) {
+            selectivity_ = 0.0;
+            return;
+        }
+
+        // From the histogram when there is one, else uniform between min
+        // and max; never below one distinct value once the range overlaps
+        double covered;
+        if (!stats->quantiles.empty()) {
+            covered = histogram_fraction(stats->quantiles, hi, true)
+                - histogram_fraction(stats->quantiles, lo, false);
+        } else {
+            const double width = stats->max - stats->min;
+            covered = width > 0.0 ? (hi - lo) / width : 1.0;
+        }
+        covered = std::max(covered, 1.0 / static_cast<double>(std::max<std::size_t>(1, stats->distinct)));
+        selectivity_ = fraction(stats->present, *stats) * std::min(covered, 1.0);
+    }
+
+    void RangeQuery::explain(std::ostream& out, int depth) const {
+        std::string text = "RANGE " + column_;
+        if (category_ == dob::ColumnCategory::STRING) {
+            text.append(" [\"").append(minText_).append("\", \"").append(maxText_).append("\"]");
+        } else {
+            text.append(" [").append(format_number(minNumber_)).append(", ")
+                .append(format_number(maxNumber_)).append("]");
+        }
+        explain_line(out, depth, text, cost_, selectivity_);
+    }
+
+    std::string RangeQuery::canonical() const {
+        std::string text = "range(" + column_ + ",";
+        if (category_ == dob::ColumnCategory::STRING) {
+            text.append(canonical_text(minText_)).append(",").append(canonical_text(maxText_));
+        } else {
+            text.append(canonical_number(minNumber_)).append(",").append(canonical_number(maxNumber_));
+        }
+        text.push_back(')');
+        return text;
+    }
+
+    std::optional<Candidates> RangeQuery::candidates(const IndexSource& indexes) const {
+        if (category_ == dob::ColumnCategory::NUMERIC || category_ == dob::ColumnCategory::DATE) {
+            auto count = indexes.range_count(columnIndex_, minNumber_, maxNumber_);
+            if (count) {
+                const double selectivity = static_cast<double>(*count)
+                    / static_cast<double>(std::max<std::size_t>(1, indexes.row_count()));
+                if (selectivity <= kMaxIndexSelectivity) {
+                    auto rows = indexes.range_rows(columnIndex_, minNumber_, maxNumber_);
+                    if (rows) { return Candidates{std::move(*rows), true}; }
+                }
+            }
+
+            // Zone maps only rule out blocks; the rows left still need eval
+            auto blocks = indexes.zone_rows(columnIndex_, minNumber_, maxNumber_);
+            if (!blocks) { return std::nullopt; }
+            return Candidates{std::move(*blocks), false};
+        }
+
+        if (!codeSource_) { return std::nullopt; }
+
+        Candidates result{RowBitmap{}, true};
+        for (uint32_t code = codeBegin_; code < codeEnd_; ++code) {
+            auto rows = indexes.value_rows(columnIndex_, code);
+            if (!rows) { return std::nullopt; }
+            result.rows = result.rows | *rows;
+        }
+        return result;
+    }
+
+    template <dob::ColumnCategory C>
+    bool RangeQuery::eval_as(RowContext& row) const {
+        auto value = ColumnTraits<C>::read(row, columnIndex_);
+        if (!value) { return false; }
+        if constexpr (C == dob::ColumnCategory::STRING) {
+            return *value >= minText_ && *value <= maxText_;
         } else {
-            // Range check on numeric values
-            double parsed = parse_numeric(field);
-            double minVal = safe_any_cast_numeric(minValue_);
-            double maxVal = safe_any_cast_numeric(maxValue_);
-            return parsed >= minVal && parsed <= maxVal;
+            return *value >= minNumber_ && *value <= maxNumber_;
         }
+    }
+
+    bool RangeQuery::eval(RowContext& row) {
+        if (codeSource_ && row.source() == codeSource_) {
+            auto code = row.code(columnIndex_);
+            return code && *code >= codeBegin_ && *code < codeEnd_;
+        }
+
+        if (sharedSlot_ >= 0) {
+            return row.shared(sharedSlot_, [&] { return (this->*evalTyped_)(row); });
+        }
+        return (this->*evalTyped_)(row);
     };
 
+    void RangeQuery::eval_batch(const ColumnSource& source, std::size_t begin,
+                                std::size_t count, BatchMask& out, SharedMasks* shared) {
+        if (shared && sharedSlot_ >= 0) {
+            shared->shared(sharedSlot_, out, [&](BatchMask& mask) { eval_batch(source, begin, count, mask); });
+            return;
+        }
+
+        const uint16_t* fieldCounts = source.field_counts();
+        const ColumnArray values = source.column_array(columnIndex_);
+
+        bool tested = false;
+        if (fieldCounts) {
+            if (category_ != dob::ColumnCategory::STRING) {
+                tested = mask_numeric(values, begin, count, minNumber_, maxNumber_, out);
+            } else if (codeSource_ == &source && values.type == ColumnArray::Type::CODES) {
+                if (codeEnd_ > codeBegin_) {
+                    mask_in_range(values.as<uint32_t>() + begin, count, codeBegin_, codeEnd_ - 1, out);
+                } else {
+                    out.fill(0);
+                }
+                tested = true;
+            }
+        }
+
+        if (!tested) {
+            Query::eval_batch(source, begin, count, out);
+            return;
+        }
+        mask_present(fieldCounts, columnIndex_, begin, count, out);
+    }
+
 } // namespace query
@@ -1,45 +1,434 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <memory>
 #include <any>
+#include <optional>
 #include <type_traits>
 #include "../dob/DobParseUtils.hpp"
+#include "BatchKernels.hpp"
+#include "RowBitmap.hpp"
 
 namespace query {
+    // Planner statistics for one column of a ColumnSource
+    struct ColumnStats {
+        std::size_t rows = 0;        // rows in the source
+        std::size_t present = 0;     // rows holding the column
+        std::size_t distinct = 0;
+        double min = 0.0;            // numeric and date columns
+        double max = 0.0;
+        std::size_t true_rows = 0;   // boolean columns
+
+        // Equi-depth histogram of a numeric or date column: bucket
+        // boundaries from min to max (empty when unknown)
+        std::vector<double> quantiles;
+    };
+
+    // One column of a ColumnSource as a flat array over all rows, so a
+    // block of rows can be tested without a virtual call per row
+    struct ColumnArray {
+        enum class Type {
+            NONE,       // per-row reads only
+            F64,        // double
+            I32,        // int32_t, a numeric column of small integers
+            DATE,       // dob::Date
+            BITMAP,     // uint64_t words, 64 rows each
+            CODES,      // uint32_t dictionary codes
+        };
+
+        Type type = Type::NONE;
+        const void* data = nullptr;
+
+        template <typename T>
+        const T* as() const { return static_cast<const T*>(data); }
+    };
+
+    // Typed, already-parsed column values (e.g. a columnar cache of the CSV).
+    // Columns are addressed by CSV column index, rows by row index.
+    class ColumnSource {
+    public:
+        virtual ~ColumnSource() = default;
+
+        // Number of fields the row had in the CSV (columns past it are missing)
+        virtual int field_count(std::size_t row) const = 0;
+
+        virtual std::string_view text(std::size_t row, int column) const = 0;
+        virtual double number(std::size_t row, int column) const = 0;
+        virtual bool flag(std::size_t row, int column) const = 0;
+        virtual dob::Date date(std::size_t row, int column) const = 0;
+
+        // Dictionary-encoded string columns. Codes follow the sort order of
+        // the values, so equality and ranges can be answered on codes alone.
+        virtual bool has_codes(int column) const { (void)column; return false; }
+        virtual uint32_t code(std::size_t row, int column) const { (void)row; (void)column; return 0; }
+        virtual std::size_t dictionary_size(int column) const { (void)column; return 0; }
+        virtual std::string_view dictionary_value(int column, uint32_t code) const { (void)column; (void)code; return {}; }
+
+        // First code whose value is >= value (dictionary_size() if none)
+        virtual uint32_t lower_code(int column, std::string_view value) const { (void)column; (void)value; return 0; }
+
+        // Code of value, or nullopt when it never occurs in the column
+        std::optional<uint32_t> find_code(int column, std::string_view value) const;
+
+        // Statistics for the planner; nullopt when the source has none
+        virtual std::optional<ColumnStats> stats(int column) const { (void)column; return std::nullopt; }
+
+        // Rows holding a dictionary code
+        virtual std::size_t code_rows(int column, uint32_t code) const { (void)column; (void)code; return 0; }
+
+        // Flat arrays for batch evaluation: the typed values of a column, and
+        // the field count of every row. NONE / nullptr when not available.
+        virtual ColumnArray column_array(int column) const { (void)column; return {}; }
+        virtual const uint16_t* field_counts() const { return nullptr; }
+    };
+
+    // Secondary indexes over a file's rows, consulted before any row is read
+    class IndexSource {
+    public:
+        virtual ~IndexSource() = default;
+
+        virtual std::size_t row_count() const = 0;
+
+        // Rows whose column holds the given dictionary code (for boolean
+        // columns code 1 is true, 0 is false); nullopt when not indexed
+        virtual std::optional<RowBitmap> value_rows(int column, uint32_t code) const {
+            (void)column; (void)code; return std::nullopt;
+        }
+
+        // Number of rows whose numeric or date column lies in [lo, hi];
+        // nullopt when the column has no range index
+        virtual std::optional<std::size_t> range_count(int column, double lo, double hi) const {
+            (void)column; (void)lo; (void)hi; return std::nullopt;
+        }
+
+        // The rows counted by range_count
+        virtual std::optional<RowBitmap> range_rows(int column, double lo, double hi) const {
+            (void)column; (void)lo; (void)hi; return std::nullopt;
+        }
+
+        // Zone maps: the rows of every block whose summary admits a value
+        // in [lo, hi], or the given string. A superset of the matches;
+        // nullopt when the column has no zone map.
+        virtual std::optional<RowBitmap> zone_rows(int column, double lo, double hi) const {
+            (void)column; (void)lo; (void)hi; return std::nullopt;
+        }
+        virtual std::optional<RowBitmap> zone_rows(int column, std::string_view value) const {
+            (void)column; (void)value; return std::nullopt;
+        }
+    };
+
+    // Rows a query can match, as narrowed down by secondary indexes
+    struct Candidates {
+        RowBitmap rows;
+        bool exact = false;   // rows are exactly the matches; no row needs evaluating
+    };
+
+    // One CSV row as seen by a query tree. The row is split at most once, on
+    // the first field access, and only as far as the highest column any
+    // predicate of the tree reads. A context can instead be bound to a
+    // ColumnSource, in which case typed values are read without parsing.
+    class RowContext {
+    private:
+        std::string_view row_;
+        std::vector<std::string_view> fields_;
+        int maxColumn_;
+        bool split_ = false;
+        bool complete_ = false;
+
+        const ColumnSource* source_ = nullptr;
+        std::size_t rowIndex_ = 0;
+
+        // Per shared slot: 0 not evaluated yet for this row, else 1 + result
+        std::vector<uint8_t> shared_;
+
+        // Text of this row's fields that had doubled quotes, collapsed; the
+        // first unescapedUsed_ are in use
+        std::deque<std::string> unescaped_;
+        std::size_t unescapedUsed_ = 0;
+
+        bool has_column(int column) const;
+
+    public:
+        // max_column < 0 splits the whole row
+        explicit RowContext(int maxColumn = -1);
+        RowContext(std::string_view row, int maxColumn);
+        explicit RowContext(const ColumnSource& source);
+
+        // Point the context at a new row, keeping the field buffer
+        void reset(std::string_view row);
+        void reset(std::string_view row, int maxColumn);
+
+        // Point a source-bound context at another row index
+        void reset(std::size_t rowIndex);
+
+        std::string_view row() const { return row_; }
+        std::size_t row_index() const { return rowIndex_; }
+        const ColumnSource* source() const { return source_; }
+
+        // Raw field text, or nullopt when the row has no such column
+        // (always nullopt for a source-bound context)
+        std::optional<std::string_view> field(int column);
+
+        // Typed field values, or nullopt when the row has no such column.
+        // Text is unquoted with doubled quotes collapsed, as in parse_row,
+        // and stays valid until the next reset.
+        std::optional<std::string_view> text(int column);
+        std::optional<double> number(int column);
+        std::optional<bool> flag(int column);
+        std::optional<dob::Date> date(int column);
+
+        // Dictionary code of a string column (source-bound contexts only)
+        std::optional<uint32_t> code(int column);
+
+        // Room for the results of slots leaf predicates shared by several
+        // query trees (Query::share_as); forgotten on every reset
+        void share_slots(std::size_t slots) { shared_.assign(slots, 0); }
+
+        // The result kept in slot for this row, computed by eval on first
+        // use; a slot the context has no room for is never kept
+        template <typename Eval>
+        bool shared(int slot, Eval&& eval) {
+            if (slot < 0 || static_cast<std::size_t>(slot) >= shared_.size()) { return eval(); }
+            uint8_t& known = shared_[static_cast<std::size_t>(slot)];
+            if (known == 0) { known = eval() ? 2 : 1; }
+            return known == 2;
+        }
+    };
+
+    // Masks of the leaf predicates shared by several query trees
+    // (Query::share_as) for the block being evaluated: the eval_batch
+    // counterpart of RowContext's shared slots, forgotten on every reset
+    class SharedMasks {
+    private:
+        std::vector<BatchMask> masks_;
+        std::vector<uint8_t> known_;
+
+    public:
+        explicit SharedMasks(std::size_t slots = 0) : masks_(slots), known_(slots, 0) {}
+
+        // Move on to the next block
+        void reset();
+
+        // Set out to the mask kept in slot for this block, computed into it
+        // by eval on first use; a slot with no room is never kept
+        template <typename Eval>
+        void shared(int slot, BatchMask& out, Eval&& eval) {
+            if (slot < 0 || static_cast<std::size_t>(slot) >= masks_.size()) { eval(out); return; }
+            BatchMask& mask = masks_[static_cast<std::size_t>(slot)];
+            uint8_t& known = known_[static_cast<std::size_t>(slot)];
+            if (!known) { eval(mask); known = 1; }
+            out = mask;
+        }
+    };
+
+    // Typed read of a column of each category, so a predicate can be
+    // specialized on its column type at compile time
+    template <dob::ColumnCategory C>
+    struct ColumnTraits;
+
+    template <>
+    struct ColumnTraits<dob::ColumnCategory::STRING> {
+        static std::optional<std::string_view> read(RowContext& row, int column) { return row.text(column); }
+    };
+
+    template <>
+    struct ColumnTraits<dob::ColumnCategory::BOOLEAN> {
+        static std::optional<bool> read(RowContext& row, int column) { return row.flag(column); }
+    };
+
+    template <>
+    struct ColumnTraits<dob::ColumnCategory::NUMERIC> {
+        static std::optional<double> read(RowContext& row, int column) { return row.number(column); }
+    };
+
+    // Dates compare as their YYYYMMDD number
+    template <>
+    struct ColumnTraits<dob::ColumnCategory::DATE> {
+        static std::optional<double> read(RowContext& row, int column) {
+            auto value = row.date(column);
+            if (!value) { return std::nullopt; }
+            return static_cast<double>(*value);
+        }
+    };
+
     class Query {
     public:
         virtual ~Query() = default;
 
         // Evaluate the query against a CSV row
-        virtual bool eval(std::string_view row) = 0;
+        bool eval(std::string_view row);
+
+        // Evaluate the query against a row shared by the whole query tree
+        virtual bool eval(RowContext& row) = 0;
+
+        // Evaluate rows [begin, begin + count) of source at once, count <=
+        // kBatchRows: bit i of out is set when row begin + i matches and bits
+        // past count are cleared. The query must be bound to source. Leaves
+        // test whole column arrays and AND/OR/NOT combine masks; the default
+        // evaluates row by row. With shared, leaves marked by share_as
+        // reuse the mask another tree computed for the same block.
+        virtual void eval_batch(const ColumnSource& source, std::size_t begin,
+                                std::size_t count, BatchMask& out, SharedMasks* shared = nullptr);
+
+        // Highest CSV column index read by this query (-1 if none)
+        virtual int max_column() const = 0;
+
+        // Prepare for evaluation against contexts bound to source (nullptr
+        // for plain CSV rows): resolve values to dictionary codes and plan
+        // the evaluation order. Must not run concurrently with eval.
+        virtual void bind(const ColumnSource* source) { (void)source; }
+
+        // Narrow the query down with secondary indexes, without touching any
+        // row. nullopt when the indexes say nothing about this query.
+        virtual std::optional<Candidates> candidates(const IndexSource& indexes) const {
+            (void)indexes; return std::nullopt;
+        }
+
+        // Planner estimates as of the last bind(): relative cost of one eval
+        // and the fraction of rows expected to match
+        virtual double cost() const = 0;
+        virtual double selectivity() const = 0;
+
+        // The plan chosen by the last bind(), one node per line
+        std::string explain() const;
+        virtual void explain(std::ostream& out, int depth) const = 0;
+
+        // Normal form of the query, e.g. for caching its results: nested
+        // AND / OR children are flattened, sorted and deduplicated and
+        // NOT NOT x is x, so trees that only differ in those ways share one
+        // form. Empty when the query has none (it is then never cached).
+        virtual std::string canonical() const { return {}; }
+
+        // Stable 64-bit hash (FNV-1a) of canonical(), the same across runs
+        uint64_t fingerprint() const;
+
+        // Canonical forms of the terms this query contributes to an AND
+        // (conjunctive) or OR parent: a node of the same kind contributes
+        // its children's terms, any other query itself
+        virtual void canonical_terms(bool conjunctive, std::vector<std::string>& out) const;
+
+        // Leaf predicates of the tree: AND / OR / NOT contribute their
+        // children's leaves, any other query itself
+        virtual void leaves(std::vector<Query*>& out) { out.push_back(this); }
+
+        // Keep this leaf's result for the current row (or block) in a slot
+        // of the RowContext (or SharedMasks), so trees that share the
+        // predicate evaluate it once; -1 (the default) keeps nothing
+        void share_as(int slot) { sharedSlot_ = slot; }
+
+    protected:
+        int sharedSlot_ = -1;
+    };
+
+    // Evaluation order of the children of an AND or OR. bind() sorts the
+    // children by estimated cost and selectivity; pass rates observed on
+    // sampled rows replace the estimates from then on, so the next bind()
+    // adapts to the data actually seen.
+    class ChildPlan {
+    private:
+        std::vector<std::size_t> order_;
+        std::unique_ptr<std::atomic<uint64_t>[]> passes_;
+        std::atomic<uint64_t> samples_{0};
+        double cost_ = 0.0;
+        double selectivity_ = 0.0;
+
+        // Observations needed before they override the estimates
+        static constexpr uint64_t kMinSamples = 64;
+
+    public:
+        explicit ChildPlan(std::size_t children);
+
+        const std::vector<std::size_t>& order() const { return order_; }
+        double cost() const { return cost_; }
+        double selectivity() const { return selectivity_; }
+
+        // True for the rows on which every child is evaluated and recorded
+        static bool sample();
+        void record(std::size_t child, bool passed);
+        void end_sample() { samples_.fetch_add(1, std::memory_order_relaxed); }
+
+        // The same for a sampled block of rows: passes of a child, then the
+        // number of rows in the block
+        void record_batch(std::size_t child, uint64_t passes);
+        void end_batch(std::size_t rows) { samples_.fetch_add(rows, std::memory_order_relaxed); }
+
+        // Observed pass rate of a child, once enough rows were sampled
+        std::optional<double> observed(std::size_t child) const;
+
+        // Reorder for AND (conjunctive) or OR and recompute the estimates
+        void plan(const std::vector<std::unique_ptr<Query>>& children, bool conjunctive);
+
+        void explain(const std::vector<std::unique_ptr<Query>>& children,
+                     std::ostream& out, int depth) const;
     };
 
     // Logical AND query - all subqueries must match
     class AndQuery : public Query {
     private:
         std::vector<std::unique_ptr<Query>> subqueries_;
+        ChildPlan plan_;
     public:
         explicit AndQuery(std::vector<std::unique_ptr<Query>> subqueries);
 
         template<typename... Queries>
         explicit AndQuery(Queries&&... queries);
 
-        bool eval(std::string_view row) override;
+        using Query::eval;
+        using Query::explain;
+        bool eval(RowContext& row) override;
+        void eval_batch(const ColumnSource& source, std::size_t begin,
+                        std::size_t count, BatchMask& out, SharedMasks* shared = nullptr) override;
+        int max_column() const override;
+        void bind(const ColumnSource* source) override;
+        std::optional<Candidates> candidates(const IndexSource& indexes) const override;
+        double cost() const override { return plan_.cost(); }
+        double selectivity() const override { return plan_.selectivity(); }
+        void explain(std::ostream& out, int depth) const override;
+        std::string canonical() const override;
+        void canonical_terms(bool conjunctive, std::vector<std::string>& out) const override;
+        void leaves(std::vector<Query*>& out) override;
     };
 
     // Logical OR query - any subquery must match
     class OrQuery : public Query {
     private:
         std::vector<std::unique_ptr<Query>> subqueries_;
+        ChildPlan plan_;
+
+        // Set when every subquery matches the same dictionary column: the
+        // whole OR becomes one membership test on the row's code
+        const ColumnSource* codeSource_ = nullptr;
+        int codeColumn_ = -1;
+        std::vector<uint8_t> codeSet_;
+        double codeSetSelectivity_ = 0.0;
+
     public:
         explicit OrQuery(std::vector<std::unique_ptr<Query>> subqueries);
 
         template<typename... Queries>
         explicit OrQuery(Queries&&... queries);
 
-        bool eval(std::string_view row) override;
+        using Query::eval;
+        using Query::explain;
+        bool eval(RowContext& row) override;
+        void eval_batch(const ColumnSource& source, std::size_t begin,
+                        std::size_t count, BatchMask& out, SharedMasks* shared = nullptr) override;
+        int max_column() const override;
+        void bind(const ColumnSource* source) override;
+        std::optional<Candidates> candidates(const IndexSource& indexes) const override;
+        double cost() const override;
+        double selectivity() const override;
+        void explain(std::ostream& out, int depth) const override;
+        std::string canonical() const override;
+        void canonical_terms(bool conjunctive, std::vector<std::string>& out) const override;
+        void leaves(std::vector<Query*>& out) override;
     };
 
     class NotQuery : public Query {
@@ -48,16 +437,47 @@ namespace query {
     public:
         explicit NotQuery(std::unique_ptr<Query> subquery);
 
-        bool eval(std::string_view row) override;
+        using Query::eval;
+        using Query::explain;
+        bool eval(RowContext& row) override;
+        void eval_batch(const ColumnSource& source, std::size_t begin,
+                        std::size_t count, BatchMask& out, SharedMasks* shared = nullptr) override;
+        int max_column() const override;
+        void bind(const ColumnSource* source) override;
+        std::optional<Candidates> candidates(const IndexSource& indexes) const override;
+        double cost() const override { return subquery_->cost(); }
+        double selectivity() const override { return 1.0 - subquery_->selectivity(); }
+        void explain(std::ostream& out, int depth) const override;
+        std::string canonical() const override;
+        void leaves(std::vector<Query*>& out) override;
     };
 
     // Equality match query - field equals a value
     class MatchQuery : public Query {
     private:
+        std::string column_;
         int columnIndex_;
         dob::ColumnCategory category_;
-        std::any value_;
-        const std::type_info* columnType_;
+
+        // Value resolved once at construction for the column's category
+        std::string text_;
+        double number_ = 0.0;
+        bool flag_ = false;
+
+        // Dictionary code of text_ once bound to a source that encodes the
+        // column; no code means the value never occurs there
+        const ColumnSource* codeSource_ = nullptr;
+        std::optional<uint32_t> code_;
+
+        // Comparison specialized for category_, picked once at construction
+        template <dob::ColumnCategory C>
+        bool eval_as(RowContext& row) const;
+        bool (MatchQuery::*evalTyped_)(RowContext&) const = nullptr;
+
+        // Planner estimates for the current binding
+        double cost_ = 1.0;
+        double selectivity_ = 1.0;
+        void estimate(const ColumnSource* source);
 
     public:
         MatchQuery(std::string_view column, const std::any& value);
@@ -71,18 +491,59 @@ namespace query {
         MatchQuery(std::string_view column, const char* value)
             : MatchQuery(column, std::any(std::string(value))) {}
 
-        bool eval(std::string_view row) override;
+        int column_index() const { return columnIndex_; }
+        dob::ColumnCategory category() const { return category_; }
+        const std::string& text_value() const { return text_; }
+
+        using Query::eval;
+        using Query::explain;
+        bool eval(RowContext& row) override;
+        void eval_batch(const ColumnSource& source, std::size_t begin,
+                        std::size_t count, BatchMask& out, SharedMasks* shared = nullptr) override;
+        int max_column() const override;
+        void bind(const ColumnSource* source) override;
+        std::optional<Candidates> candidates(const IndexSource& indexes) const override;
+        double cost() const override { return cost_; }
+        double selectivity() const override { return selectivity_; }
+        void explain(std::ostream& out, int depth) const override;
+        std::string canonical() const override;
     };
 
     // Range query - field is between min and max values
-    // Supports: numeric columns and string columns
+    // Supports: numeric, date (YYYYMMDD bounds) and string columns
     // Does not support: boolean columns
     class RangeQuery : public Query {
     private:
+        std::string column_;
         int columnIndex_;
         dob::ColumnCategory category_;
-        std::any minValue_;
-        std::any maxValue_;
+
+        // Bounds resolved once at construction for the column's category
+        std::string minText_;
+        std::string maxText_;
+        double minNumber_ = 0.0;
+        double maxNumber_ = 0.0;
+
+        // Matching code range [codeBegin_, codeEnd_) once bound to a source
+        // with a sorted dictionary for the column
+        const ColumnSource* codeSource_ = nullptr;
+        uint32_t codeBegin_ = 0;
+        uint32_t codeEnd_ = 0;
+
+        // Comparison specialized for category_, picked once at construction
+        template <dob::ColumnCategory C>
+        bool eval_as(RowContext& row) const;
+        bool (RangeQuery::*evalTyped_)(RowContext&) const = nullptr;
+
+        // Planner estimates for the current binding
+        double cost_ = 1.0;
+        double selectivity_ = 1.0;
+        void estimate(const ColumnSource* source);
+
+        // A range index is only used when it selects at most this fraction
+        // of the rows; past that, collecting and sorting the row ids costs
+        // more than scanning the column
+        static constexpr double kMaxIndexSelectivity = 0.10;
 
     public:
         RangeQuery(std::string_view column, const std::any& minValue, const std::any& maxValue);
@@ -106,7 +567,18 @@ namespace query {
         RangeQuery(std::string_view column, const char* minValue, const char* maxValue)
             : RangeQuery(column, std::any(std::string(minValue)), std::any(std::string(maxValue))) {}
 
-        bool eval(std::string_view row) override;
+        using Query::eval;
+        using Query::explain;
+        bool eval(RowContext& row) override;
+        void eval_batch(const ColumnSource& source, std::size_t begin,
+                        std::size_t count, BatchMask& out, SharedMasks* shared = nullptr) override;
+        int max_column() const override;
+        void bind(const ColumnSource* source) override;
+        std::optional<Candidates> candidates(const IndexSource& indexes) const override;
+        double cost() const override { return cost_; }
+        double selectivity() const override { return selectivity_; }
+        void explain(std::ostream& out, int depth) const override;
+        std::string canonical() const override;
     };
 
 } // namespace query
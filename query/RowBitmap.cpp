@@ -0,0 +1,316 @@
+#include "RowBitmap.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace query {
+
+    namespace {
+        std::size_t popcount(uint64_t word) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            return static_cast<std::size_t>(__popcnt64(word));
+#else
+            return static_cast<std::size_t>(__builtin_popcountll(word));
+#endif
+        }
+
+        template <typename T>
+        void put(std::vector<char>& out, const T& value) {
+            const char* p = reinterpret_cast<const char*>(&value);
+            out.insert(out.end(), p, p + sizeof(T));
+        }
+
+        template <typename T>
+        T take(const char*& p, const char* end) {
+            if (static_cast<std::size_t>(end - p) < sizeof(T)) {
+                throw std::runtime_error("Truncated bitmap");
+            }
+            T value;
+            std::memcpy(&value, p, sizeof(T));
+            p += sizeof(T);
+            return value;
+        }
+    }
+
+    std::size_t RowBitmap::Container::cardinality() const {
+        if (!dense()) {
+            return array.size();
+        }
+        std::size_t n = 0;
+        for (uint64_t word : bits) {
+            n += popcount(word);
+        }
+        return n;
+    }
+
+    void RowBitmap::to_dense(Container& c) {
+        if (c.dense()) {
+            return;
+        }
+        c.bits.assign(kWords, 0);
+        for (uint16_t low : c.array) {
+            c.bits[low >> 6] |= uint64_t{1} << (low & 63);
+        }
+        c.array.clear();
+        c.array.shrink_to_fit();
+    }
+
+    // Pick the cheaper representation for the container's current contents
+    void RowBitmap::normalize(Container& c) {
+        if (!c.dense()) {
+            if (c.array.size() > kArrayMax) {
+                to_dense(c);
+            }
+            return;
+        }
+        if (c.cardinality() > kArrayMax) {
+            return;
+        }
+        std::vector<uint16_t> array;
+        for (std::size_t w = 0; w < kWords; ++w) {
+            for (uint64_t word = c.bits[w]; word != 0; word &= word - 1) {
+                array.push_back(static_cast<uint16_t>(w * 64 + static_cast<std::size_t>(dob::lowest_bit(word))));
+            }
+        }
+        c.array = std::move(array);
+        c.bits.clear();
+        c.bits.shrink_to_fit();
+    }
+
+    // Set bits [lo, hi) of a dense container a word at a time
+    void RowBitmap::set_bits(Container& c, uint64_t lo, uint64_t hi) {
+        for (uint64_t bit = lo; bit < hi; ) {
+            const uint64_t w = bit >> 6;
+            const uint64_t first = bit & 63;
+            const uint64_t last = std::min<uint64_t>(64, hi - (w << 6));
+            const uint64_t span = last - first;
+            const uint64_t mask = span == 64 ? ~uint64_t{0} : ((uint64_t{1} << span) - 1) << first;
+            c.bits[w] |= mask;
+            bit = (w + 1) << 6;
+        }
+    }
+
+    RowBitmap RowBitmap::range(uint32_t begin, uint32_t end) {
+        RowBitmap out;
+        out.add_range(begin, end);
+        return out;
+    }
+
+    void RowBitmap::add(uint32_t row) {
+        const auto key = static_cast<uint16_t>(row >> 16);
+        const auto low = static_cast<uint16_t>(row & 0xFFFF);
+
+        if (containers_.empty() || containers_.back().key != key) {
+            if (!containers_.empty() && containers_.back().key > key) {
+                throw std::invalid_argument("RowBitmap rows must be added in order");
+            }
+            containers_.push_back(Container{key, {}, {}});
+        }
+
+        auto& c = containers_.back();
+        if (c.dense()) {
+            c.bits[low >> 6] |= uint64_t{1} << (low & 63);
+        } else {
+            if (c.array.empty() || c.array.back() < low) {
+                c.array.push_back(low);
+            }
+            if (c.array.size() > kArrayMax) {
+                to_dense(c);
+            }
+        }
+    }
+
+    void RowBitmap::add_range(uint32_t begin, uint32_t end) {
+        uint64_t row = begin;
+        while (row < end) {
+            const auto key = static_cast<uint16_t>(row >> 16);
+            const uint64_t group_end = std::min<uint64_t>((static_cast<uint64_t>(key) + 1) << 16, end);
+
+            if (containers_.empty() || containers_.back().key != key) {
+                if (!containers_.empty() && containers_.back().key > key) {
+                    throw std::invalid_argument("RowBitmap rows must be added in order");
+                }
+                containers_.push_back(Container{key, {}, {}});
+            }
+
+            // Rows [lo, hi) of the group; a range that would overflow the
+            // array goes straight to the bitset
+            auto& c = containers_.back();
+            uint64_t lo = row & 0xFFFF;
+            const uint64_t hi = group_end - (static_cast<uint64_t>(key) << 16);
+            if (!c.dense() && c.array.size() + (hi - lo) > kArrayMax) {
+                to_dense(c);
+            }
+            if (c.dense()) {
+                set_bits(c, lo, hi);
+            } else {
+                if (!c.array.empty()) {
+                    lo = std::max<uint64_t>(lo, c.array.back() + 1u);
+                }
+                for (uint64_t low = lo; low < hi; ++low) {
+                    c.array.push_back(static_cast<uint16_t>(low));
+                }
+            }
+            row = group_end;
+        }
+    }
+
+    bool RowBitmap::contains(uint32_t row) const {
+        const auto key = static_cast<uint16_t>(row >> 16);
+        const auto low = static_cast<uint16_t>(row & 0xFFFF);
+
+        auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+            [](const Container& c, uint16_t k) { return c.key < k; });
+        if (it == containers_.end() || it->key != key) {
+            return false;
+        }
+        if (it->dense()) {
+            return (it->bits[low >> 6] >> (low & 63)) & 1u;
+        }
+        return std::binary_search(it->array.begin(), it->array.end(), low);
+    }
+
+    std::size_t RowBitmap::cardinality() const {
+        std::size_t n = 0;
+        for (const auto& c : containers_) {
+            n += c.cardinality();
+        }
+        return n;
+    }
+
+    std::size_t RowBitmap::memory_bytes() const {
+        std::size_t n = sizeof(RowBitmap) + containers_.capacity() * sizeof(Container);
+        for (const auto& c : containers_) {
+            n += c.array.capacity() * sizeof(uint16_t) + c.bits.capacity() * sizeof(uint64_t);
+        }
+        return n;
+    }
+
+    RowBitmap RowBitmap::combine(const RowBitmap& a, const RowBitmap& b, Op op) {
+        RowBitmap out;
+        auto ia = a.containers_.begin();
+        auto ib = b.containers_.begin();
+
+        while (ia != a.containers_.end() || ib != b.containers_.end()) {
+            const bool has_a = ia != a.containers_.end();
+            const bool has_b = ib != b.containers_.end();
+
+            // Groups present on one side only
+            if (has_a && (!has_b || ia->key < ib->key)) {
+                if (op != Op::AND) {
+                    out.containers_.push_back(*ia);
+                }
+                ++ia;
+                continue;
+            }
+            if (has_b && (!has_a || ib->key < ia->key)) {
+                if (op == Op::OR) {
+                    out.containers_.push_back(*ib);
+                }
+                ++ib;
+                continue;
+            }
+
+            Container c;
+            c.key = ia->key;
+
+            if (!ia->dense() && !ib->dense()) {
+                auto dst = std::back_inserter(c.array);
+                switch (op) {
+                    case Op::AND:
+                        std::set_intersection(ia->array.begin(), ia->array.end(),
+                                              ib->array.begin(), ib->array.end(), dst);
+                        break;
+                    case Op::OR:
+                        std::set_union(ia->array.begin(), ia->array.end(),
+                                       ib->array.begin(), ib->array.end(), dst);
+                        break;
+                    case Op::ANDNOT:
+                        std::set_difference(ia->array.begin(), ia->array.end(),
+                                            ib->array.begin(), ib->array.end(), dst);
+                        break;
+                }
+            } else {
+                Container x = *ia;
+                Container y = *ib;
+                to_dense(x);
+                to_dense(y);
+                c.bits.resize(kWords);
+                for (std::size_t w = 0; w < kWords; ++w) {
+                    switch (op) {
+                        case Op::AND: c.bits[w] = x.bits[w] & y.bits[w]; break;
+                        case Op::OR: c.bits[w] = x.bits[w] | y.bits[w]; break;
+                        case Op::ANDNOT: c.bits[w] = x.bits[w] & ~y.bits[w]; break;
+                    }
+                }
+            }
+
+            normalize(c);
+            if (c.cardinality() != 0) {
+                out.containers_.push_back(std::move(c));
+            }
+            ++ia;
+            ++ib;
+        }
+
+        return out;
+    }
+
+    std::vector<uint32_t> RowBitmap::to_vector() const {
+        std::vector<uint32_t> rows;
+        rows.reserve(cardinality());
+        for_each([&](uint32_t row) { rows.push_back(row); });
+        return rows;
+    }
+
+    // Layout: u32 container count, then per container
+    // u16 key, u16 dense flag, u32 length, and either length u16 values or
+    // 1024 u64 words
+    void RowBitmap::serialize(std::vector<char>& out) const {
+        put(out, static_cast<uint32_t>(containers_.size()));
+        for (const auto& c : containers_) {
+            put(out, c.key);
+            put(out, static_cast<uint16_t>(c.dense() ? 1 : 0));
+            if (c.dense()) {
+                put(out, static_cast<uint32_t>(kWords));
+                for (uint64_t word : c.bits) {
+                    put(out, word);
+                }
+            } else {
+                put(out, static_cast<uint32_t>(c.array.size()));
+                for (uint16_t low : c.array) {
+                    put(out, low);
+                }
+            }
+        }
+    }
+
+    RowBitmap RowBitmap::deserialize(const char* data, std::size_t size) {
+        const char* p = data;
+        const char* end = data + size;
+
+        RowBitmap out;
+        const auto count = take<uint32_t>(p, end);
+        out.containers_.resize(count);
+        for (auto& c : out.containers_) {
+            c.key = take<uint16_t>(p, end);
+            const bool dense = take<uint16_t>(p, end) != 0;
+            const auto length = take<uint32_t>(p, end);
+            if (dense) {
+                c.bits.resize(length);
+                for (auto& word : c.bits) {
+                    word = take<uint64_t>(p, end);
+                }
+            } else {
+                c.array.resize(length);
+                for (auto& low : c.array) {
+                    low = take<uint16_t>(p, end);
+                }
+            }
+        }
+        return out;
+    }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../dob/DobCsvScan.hpp"
+
+namespace query {
+
+    // Compressed set of row indices in the style of a roaring bitmap: rows
+    // are grouped by their high 16 bits and each group is stored either as a
+    // sorted array (sparse) or as a 65536-bit bitset (dense).
+    class RowBitmap {
+    private:
+        struct Container {
+            uint16_t key = 0;
+            std::vector<uint16_t> array;    // used while the group is sparse
+            std::vector<uint64_t> bits;     // 1024 words once it is dense
+
+            bool dense() const { return !bits.empty(); }
+            std::size_t cardinality() const;
+        };
+
+        std::vector<Container> containers_;
+
+        // Groups above this size switch from array to bitset
+        static constexpr std::size_t kArrayMax = 4096;
+        static constexpr std::size_t kWords = 1024;
+
+        static void to_dense(Container& c);
+        static void normalize(Container& c);
+        static void set_bits(Container& c, uint64_t lo, uint64_t hi);
+
+        enum class Op { AND, OR, ANDNOT };
+        static RowBitmap combine(const RowBitmap& a, const RowBitmap& b, Op op);
+
+    public:
+        RowBitmap() = default;
+
+        // Every row in [begin, end)
+        static RowBitmap range(uint32_t begin, uint32_t end);
+
+        // Append a row; rows must be added in increasing order
+        void add(uint32_t row);
+
+        // Append the rows [begin, end), past every row added so far
+        void add_range(uint32_t begin, uint32_t end);
+
+        bool contains(uint32_t row) const;
+        bool empty() const { return containers_.empty(); }
+        std::size_t cardinality() const;
+
+        // Heap and inline bytes held by the bitmap
+        std::size_t memory_bytes() const;
+
+        RowBitmap operator&(const RowBitmap& other) const { return combine(*this, other, Op::AND); }
+        RowBitmap operator|(const RowBitmap& other) const { return combine(*this, other, Op::OR); }
+        RowBitmap and_not(const RowBitmap& other) const { return combine(*this, other, Op::ANDNOT); }
+
+        // Rows of [0, universe) not in this bitmap
+        RowBitmap complement(uint32_t universe) const { return range(0, universe).and_not(*this); }
+
+        // Call fn(row) for every row in increasing order
+        template <typename Fn>
+        void for_each(Fn&& fn) const {
+            for (const auto& c : containers_) {
+                const uint32_t high = static_cast<uint32_t>(c.key) << 16;
+                if (c.dense()) {
+                    for (std::size_t w = 0; w < kWords; ++w) {
+                        for (uint64_t word = c.bits[w]; word != 0; word &= word - 1) {
+                            fn(high | static_cast<uint32_t>(w * 64 + static_cast<std::size_t>(dob::lowest_bit(word))));
+                        }
+                    }
+                } else {
+                    for (uint16_t low : c.array) {
+                        fn(high | low);
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32_t> to_vector() const;
+
+        // Flat little-endian encoding used by the persisted bitmap index
+        void serialize(std::vector<char>& out) const;
+        static RowBitmap deserialize(const char* data, std::size_t size);
+    };
+
+}